@@ -7,15 +7,25 @@
 #include <linux/mm.h>
 #include <linux/mm_types.h>
 #include <linux/module.h>
-#include <linux/proc_fs.h>
+#include <linux/miscdevice.h>
+#include <linux/io.h>
 #include <linux/uaccess.h>
 #include <linux/slab.h>
 #include <linux/version.h>
 #include <linux/stddef.h>
 #include <linux/gfp.h>
 #include <linux/atomic.h>
+#include <linux/moduleparam.h>
+#include <linux/huge_mm.h>
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 17, 0)
+#include <linux/pfn_t.h>
+#endif
+#include <linux/pipe_fs_i.h>
+#include <linux/splice.h>
+#include <linux/uio.h>
 
 #include "lib/thinros_core.h"
+#include "lib/thinros_ioctl.h"
 #include "thinros_config.h"
 
 #define DRIVER_AUTHOR	"Hao Chen <hao.chen@yale.edu>"
@@ -46,37 +56,24 @@ typedef unsigned int		vm_fault_t;
 #endif
 
 
-#if LINUX_VERSION_CODE < KERNEL_VERSION(5, 6, 0)
-
-typedef struct file_operations	proc_ops_t;
-#define proc_ops_init(x, _open, _read, _write, _release, _mmap) \
-	proc_ops_t x = { \
-		.owner   = THIS_MODULE, \
-		.open    = _open, \
-		.read    = _read, \
-		.write   = _write, \
-		.release = _release, \
-		.mmap    = _mmap, \
-	}
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 3, 0)
 
-#else
+static inline void vm_flags_set(struct vm_area_struct *vma, unsigned long flags)
+{
+	vma->vm_flags |= flags;
+}
 
-typedef struct proc_ops		proc_ops_t;
-#define proc_ops_init(x, open, read, write, release, mmap) \
-	proc_ops_t x = { \
-		.proc_open    = open, \
-		.proc_read    = read, \
-		.proc_write   = write, \
-		.proc_release = release, \
-		.proc_mmap    = mmap, \
-	}
+static inline void vm_flags_clear(struct vm_area_struct *vma, unsigned long flags)
+{
+	vma->vm_flags &= ~flags;
+}
 
 #endif
 
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4, 10, 0)
 
-#define mf_address(vmf)	((unsigned long) (vmf)->virtual_address)
+#define vmf_address(vmf)	((unsigned long) (vmf)->virtual_address)
 
 #else
 
@@ -91,6 +88,32 @@ typedef int vm_fault_t;
 #else
 
 
+#endif
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 5, 0)
+
+/* splice through ->read_iter */
+#define copy_splice_read	generic_file_splice_read
+
+#endif
+
+/* pipe buffers need only .release and .get from 5.8 on */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 8, 0)
+#define THINROS_SPLICE_PAGES
+#endif
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4, 18, 0)
+
+static inline vm_fault_t vmf_insert_pfn(struct vm_area_struct *vma, unsigned long addr, unsigned long pfn)
+{
+	int err = vm_insert_pfn(vma, addr, pfn);
+	if (err == -ENOMEM)
+	{
+		return VM_FAULT_OOM;
+	}
+	return err == 0 || err == -EBUSY ? VM_FAULT_NOPAGE : VM_FAULT_SIGBUS;
+}
+
 #endif
 
 
@@ -100,43 +123,109 @@ typedef int vm_fault_t;
 
 #endif
 
+/* pmd mappings of pfn ranges, vmf_insert_pfn_pmd() takes the vm_fault */
+#if defined(CONFIG_TRANSPARENT_HUGEPAGE) && LINUX_VERSION_CODE >= KERNEL_VERSION(5, 2, 0)
+#define THINROS_HUGE_FAULT
+#endif
+
+/* pfn_t is gone from 6.17 on, vmf_insert_pfn_pmd() takes the pfn itself */
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 17, 0)
+#define thinros_pmd_pfn(paddr)	phys_to_pfn_t(paddr, PFN_DEV)
+#else
+#define thinros_pmd_pfn(paddr)	PHYS_PFN(paddr)
+#endif
+
+/*
+ * huge_pages=1: the partition is not mapped at mmap time but on faults, 2 MB
+ * at a time where the vma asks for huge pages (MADV_HUGEPAGE, see
+ * THINROS_BIND_HUGE_PAGES), one page at a time elsewhere.
+ */
+static bool huge_pages;
+module_param(huge_pages, bool, 0444);
+MODULE_PARM_DESC(huge_pages, "map the partition on faults, with 2 MB pages where requested");
+
+/*
+ * prefault=1 with huge_pages=1: the first 4 KB fault maps the whole vma, so
+ * the first message of every ring does not take its own fault. 2 MB faults
+ * still map one pmd at a time (THINROS_BIND_PREFAULT touches them all).
+ */
+static bool prefault;
+module_param(prefault, bool, 0444);
+MODULE_PARM_DESC(prefault, "with huge_pages, map the whole vma on its first 4 KB fault");
+
+/*
+ * partitions=N exposes N regions of NONSECURE_PARTITION_SIZE, region i as
+ * /dev/thinros (i = 0) or /dev/thinros<i>, so that workloads bound to
+ * different ones (THINROS_PARTITION=<i>) only meet through the master.
+ * paddrs=a,b,... gives their physical addresses, by default they follow
+ * NONSECURE_PARTITION_LOC back to back.
+ */
+static unsigned int partitions = 1;
+module_param(partitions, uint, 0444);
+MODULE_PARM_DESC(partitions, "number of partitions exposed (1 - 8)");
+
+static unsigned long paddrs[n_max_partitions];
+static int n_paddrs;
+module_param_array(paddrs, ulong, &n_paddrs, 0444);
+MODULE_PARM_DESC(paddrs, "physical address of each partition");
+
 
 struct thinros_shm_channel
 {
+	unsigned int	id;
 	unsigned long	paddr;
+	void *		vaddr;	/* kernel mapping, for read/write and the ioctls */
 	atomic_t	ref_count;
 	atomic_t	total;
+	char		name[16];
+	struct miscdevice	misc;
 };
 
 // TODO: replace with thinros queue
 struct thinros_shm_agent
 {
 	int		sid;
+	struct thinros_shm_channel * shm;
 };
 
-static struct thinros_shm_channel shm;
+static struct thinros_shm_channel shms[n_max_partitions];
 
 static void thinros_shm_link(struct vm_area_struct * vma)
 {
 	int err;
+	unsigned long paddr, size;
 	struct thinros_shm_agent * agent;
+	struct thinros_shm_channel * shm;
 
 	agent = (struct thinros_shm_agent *) vma->vm_private_data;
+	shm = agent->shm;
+
+	if (huge_pages)
+	{
+		/* mapped by thinros_vma_fault / thinros_vma_huge_fault */
+		atomic_inc(&shm->ref_count);
+		agent->sid = atomic_inc_return(&shm->total);
+		return;
+	}
 
-	debug("remap_pfn_range vma 0x%lx pfn 0x%lx size %lu protection 0x%llx\n",
-		vma->vm_start, shm.paddr >> PAGE_SHIFT, NONSECURE_PARTITION_SIZE,
+	/* only the window asked for, checked by thinros_dev_mmap */
+	paddr = shm->paddr + (vma->vm_pgoff << PAGE_SHIFT);
+	size = vma->vm_end - vma->vm_start;
+
+	debug("remap_pfn_range partition %u vma 0x%lx pfn 0x%lx size %lu protection 0x%llx\n",
+		shm->id, vma->vm_start, paddr >> PAGE_SHIFT, size,
 		(unsigned long long) vma->vm_page_prot.pgprot);
 
-	err = remap_pfn_range(vma, vma->vm_start, shm.paddr >> PAGE_SHIFT,
-				NONSECURE_PARTITION_SIZE, vma->vm_page_prot);
+	err = remap_pfn_range(vma, vma->vm_start, paddr >> PAGE_SHIFT,
+				size, vma->vm_page_prot);
 	if (err)
 	{
 		panic("error %d: failed to map physical addr 0x%lx to virtual addr 0x%lx (size %lu)\n", 
-			err, shm.paddr, vma->vm_start, (size_t) NONSECURE_PARTITION_SIZE);
+			err, paddr, vma->vm_start, size);
 	}
 
-	atomic_inc(&shm.ref_count);
-	agent->sid = atomic_inc_return(&shm.total);
+	atomic_inc(&shm->ref_count);
+	agent->sid = atomic_inc_return(&shm->total);
 }
 
 static void thinros_shm_unlink(struct vm_area_struct * vma)
@@ -146,7 +235,7 @@ static void thinros_shm_unlink(struct vm_area_struct * vma)
 
 	agent = (struct thinros_shm_agent *) vma->vm_private_data;
 	agent->sid = 0;
-	atomic_dec(&shm.ref_count);
+	atomic_dec(&agent->shm->ref_count);
 }
 
 static void thinros_vma_close(struct vm_area_struct * vma)
@@ -158,42 +247,88 @@ static void thinros_vma_close(struct vm_area_struct * vma)
 }
 
 
-static vm_fault_t _thinros_vma_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
+/* offset in the partition of a user address, NONSECURE_PARTITION_SIZE if out of bound */
+static unsigned long thinros_vma_offset(struct vm_area_struct *vma, unsigned long addr)
 {
-	struct page * page;
-	struct thinros_shm_agent * agent;
-	/* usually not happen, check the range and try to map it again */
-
-	if (shm.paddr <= vmf_address(vmf) && vmf_address(vmf) < shm.paddr + NONSECURE_PARTITION_SIZE)
-	{
-		debug("page fault @ 0x%lx, remap the page\n", vmf_address(vmf));
+	unsigned long offset = addr - vma->vm_start + (vma->vm_pgoff << PAGE_SHIFT);
+	return offset < NONSECURE_PARTITION_SIZE ? offset : NONSECURE_PARTITION_SIZE;
+}
 
-		agent = (struct thinros_shm_agent *) vma->vm_private_data;
-		if (agent->sid > 0)
-		{
-			/* map a single page */
-			unsigned long offset = PAGE_ALIGN(vmf_address(vmf)) - vma->vm_start;
-			unsigned long pfn = (shm.paddr + offset) >> PAGE_SHIFT;
-			remap_pfn_range(vma, PAGE_ALIGN(vmf_address(vmf)), pfn, PAGE_SIZE, vma->vm_page_prot);
-			page = pfn_to_page(pfn);
-			get_page(page);
-			vmf->page = page;
+/* map every page of the vma that lies in the partition, under the fault's mmap lock */
+static void thinros_vma_populate(struct vm_area_struct *vma)
+{
+	struct thinros_shm_channel * shm = ((struct thinros_shm_agent *) vma->vm_private_data)->shm;
+	unsigned long addr, offset;
 
-		}
-		else
+	for (addr = vma->vm_start; addr < vma->vm_end; addr += PAGE_SIZE)
+	{
+		offset = thinros_vma_offset(vma, addr);
+		if (offset == NONSECURE_PARTITION_SIZE
+			|| vmf_insert_pfn(vma, addr, (shm->paddr + offset) >> PAGE_SHIFT) != VM_FAULT_NOPAGE)
 		{
-			thinros_shm_link(vma);
+			break;
 		}
-		return 0;
 	}
-	else
+}
+
+static vm_fault_t _thinros_vma_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
+{
+	struct thinros_shm_channel * shm = ((struct thinros_shm_agent *) vma->vm_private_data)->shm;
+	unsigned long addr = vmf_address(vmf) & PAGE_MASK;
+	unsigned long offset = thinros_vma_offset(vma, addr);
+
+	if (offset == NONSECURE_PARTITION_SIZE)
 	{
 		panic("error: 0x%lx out of bound!\n", vmf_address(vmf));
 		/* send sigbus to user */
 		return VM_FAULT_SIGBUS;
 	}
+	if (prefault)
+	{
+		thinros_vma_populate(vma);
+	}
+	/* map a single page, a no-op if populated */
+	return vmf_insert_pfn(vma, addr, (shm->paddr + offset) >> PAGE_SHIFT);
 }
 
+#ifdef THINROS_HUGE_FAULT
+
+/* map the 2 MB around the fault with one pmd, if it lies in the partition */
+static vm_fault_t thinros_vma_fault_pmd(struct vm_fault *vmf)
+{
+	struct vm_area_struct *vma = vmf->vma;
+	struct thinros_shm_channel * shm = ((struct thinros_shm_agent *) vma->vm_private_data)->shm;
+	unsigned long addr = vmf_address(vmf) & PMD_MASK;
+	unsigned long offset = thinros_vma_offset(vma, addr);
+
+	if (addr < vma->vm_start || addr + PMD_SIZE > vma->vm_end
+		|| offset + PMD_SIZE > NONSECURE_PARTITION_SIZE
+		|| ((shm->paddr + offset) & ~PMD_MASK) != 0)
+	{
+		return VM_FAULT_FALLBACK;
+	}
+	return vmf_insert_pfn_pmd(vmf, thinros_pmd_pfn(shm->paddr + offset),
+		vmf->flags & FAULT_FLAG_WRITE);
+}
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 6, 0)
+
+static vm_fault_t thinros_vma_huge_fault(struct vm_fault *vmf, enum page_entry_size pe_size)
+{
+	return pe_size == PE_SIZE_PMD ? thinros_vma_fault_pmd(vmf) : VM_FAULT_FALLBACK;
+}
+
+#else
+
+static vm_fault_t thinros_vma_huge_fault(struct vm_fault *vmf, unsigned int order)
+{
+	return order == PMD_ORDER ? thinros_vma_fault_pmd(vmf) : VM_FAULT_FALLBACK;
+}
+
+#endif
+
+#endif /* THINROS_HUGE_FAULT */
+
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4, 10, 0)
 
 static vm_fault_t thinros_vma_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
@@ -227,36 +362,69 @@ static struct vm_operations_struct vm_ops =
 	.open  = thinros_vma_open,
 	.close = thinros_vma_close,
 	.fault = thinros_vma_fault,
+#ifdef THINROS_HUGE_FAULT
+	.huge_fault = thinros_vma_huge_fault,
+#endif
 };
 
-static int thinros_pfs_mmap(struct file * filp, struct vm_area_struct *vma)
+/*
+ * map a window of the region: the mmap offset is the region offset, e.g.
+ * from THINROS_IOC_TOPIC, so a process maps only the registry and the rings
+ * it uses. a window mapped without PROT_WRITE cannot be made writable.
+ */
+static int thinros_dev_mmap(struct file * filp, struct vm_area_struct *vma)
 {
-	debug("thinros_pfs_mmap vma start 0x%lx end 0x%lx\n", vma->vm_start, vma->vm_end);
+	unsigned long offset = vma->vm_pgoff << PAGE_SHIFT;
+
+	debug("thinros_dev_mmap vma start 0x%lx end 0x%lx offset 0x%lx\n", vma->vm_start, vma->vm_end, offset);
+	if (offset >= NONSECURE_PARTITION_SIZE
+		|| vma->vm_end - vma->vm_start > NONSECURE_PARTITION_SIZE - offset)
+	{
+		return -EINVAL;
+	}
 	vma->vm_ops = &vm_ops;
 	/* no swap */
-	vma->vm_flags |= VM_DONTEXPAND | VM_DONTDUMP;
+	vm_flags_set(vma, VM_DONTEXPAND | VM_DONTDUMP);
+	if (!(vma->vm_flags & VM_WRITE))
+	{
+		vm_flags_clear(vma, VM_MAYWRITE);
+	}
+	if (huge_pages)
+	{
+		/* faulted in by pfn, remap_pfn_range sets the same flags */
+		vm_flags_set(vma, VM_IO | VM_PFNMAP);
+	}
 	vma->vm_private_data = filp->private_data;
 	thinros_vma_open(vma);
 
 	return 0;
 }
 
-static int thinros_pfs_open (struct inode * inode, struct file * filp)
+static int thinros_dev_open (struct inode * inode, struct file * filp)
 {
 	struct thinros_shm_agent * agent;
+	/* set by the misc device layer */
+	struct miscdevice * misc = filp->private_data;
+
 	agent = kmalloc(sizeof(struct thinros_shm_agent), GFP_KERNEL);
+	if (agent == NULL)
+	{
+		return -ENOMEM;
+	}
 	agent->sid = 0;
+	agent->shm = container_of(misc, struct thinros_shm_channel, misc);
 	filp->private_data = agent;
-	debug("thinros_pfs_open is called\n");
+	debug("thinros_dev_open partition %u\n", agent->shm->id);
 	
 	return 0;
 }
 
-static ssize_t thinros_pfs_read(struct file *filp, char __user *buf, size_t len, loff_t *off)
+static ssize_t thinros_dev_read(struct file *filp, char __user *buf, size_t len, loff_t *off)
 {
+	struct thinros_shm_channel * shm = ((struct thinros_shm_agent *) filp->private_data)->shm;
 	ssize_t rd;
 
-	debug("thinros_pfs_read 0x%p size %lu offset %llu\n", buf, len, *off);
+	debug("thinros_dev_read 0x%p size %lu offset %llu\n", buf, len, *off);
 
 	if ((size_t) NONSECURE_PARTITION_SIZE <= *off)
 	{
@@ -265,7 +433,7 @@ static ssize_t thinros_pfs_read(struct file *filp, char __user *buf, size_t len,
 	else
 	{
 		rd = min(len, (size_t) NONSECURE_PARTITION_SIZE - (size_t) *off);
-		if (copy_to_user(buf, (void *)(shm.paddr + *off), rd))
+		if (copy_to_user(buf, (uint8_t *) shm->vaddr + *off, rd))
 		{
 			rd = - EFAULT;
 		}
@@ -278,27 +446,128 @@ static ssize_t thinros_pfs_read(struct file *filp, char __user *buf, size_t len,
 	return rd;
 }
 
-static ssize_t thinros_pfs_write(struct file *filp, const char __user *buf, size_t len, loff_t *off)
+static ssize_t thinros_dev_write(struct file *filp, const char __user *buf, size_t len, loff_t *off)
 {
+	struct thinros_shm_channel * shm = ((struct thinros_shm_agent *) filp->private_data)->shm;
 	unsigned long to_copy;
-	debug("thinros_pfs_write 0x%p size %lu offset %llu\n", buf, len, *off);
+	debug("thinros_dev_write 0x%p size %lu offset %llu\n", buf, len, *off);
 
-	to_copy = min(len, (size_t) NONSECURE_PARTITION_SIZE);
-	if (copy_from_user((void *)(shm.paddr + *off), buf, to_copy))
+	if ((size_t) NONSECURE_PARTITION_SIZE <= *off)
+	{
+		return -ENOSPC;
+	}
+	to_copy = min(len, (size_t) NONSECURE_PARTITION_SIZE - (size_t) *off);
+	if (copy_from_user((uint8_t *) shm->vaddr + *off, buf, to_copy))
 	{
 		return -EFAULT;
 	}
 	else
 	{
 		*off += to_copy;
-		return len;
+		return to_copy;
+	}
+}
+
+static ssize_t thinros_dev_read_iter(struct kiocb *iocb, struct iov_iter *to)
+{
+	struct thinros_shm_channel * shm = ((struct thinros_shm_agent *) iocb->ki_filp->private_data)->shm;
+	size_t want, rd;
+
+	if (iocb->ki_pos < 0 || (size_t) NONSECURE_PARTITION_SIZE <= iocb->ki_pos)
+	{
+		return 0;
+	}
+	want = min(iov_iter_count(to), (size_t) NONSECURE_PARTITION_SIZE - (size_t) iocb->ki_pos);
+	if (want == 0)
+	{
+		return 0;
+	}
+	rd = copy_to_iter((uint8_t *) shm->vaddr + iocb->ki_pos, want, to);
+	iocb->ki_pos += rd;
+	/* a short copy is a fault in the user buffer, report what made it */
+	return rd != 0 ? (ssize_t) rd : -EFAULT;
+}
+
+#ifdef THINROS_SPLICE_PAGES
+
+static void thinros_pipe_buf_release(struct pipe_inode_info *pipe, struct pipe_buffer *buf)
+{
+	put_page(buf->page);
+}
+
+static const struct pipe_buf_operations thinros_pipe_buf_ops = {
+	.release = thinros_pipe_buf_release,
+	.get     = generic_pipe_buf_get,
+};
+
+static void thinros_spd_release(struct splice_pipe_desc *spd, unsigned int i)
+{
+	put_page(spd->pages[i]);
+}
+
+/*
+ * splice a range of the region, e.g. ring slots found with THINROS_IOC_TOPIC,
+ * into a pipe by reference to its pages: sockets and files take the data
+ * from there without a copy through user space. the pages are read when the
+ * other end consumes them, so a slot overwritten meanwhile goes out
+ * overwritten. regions without struct pages (no-map carve-outs) are copied.
+ */
+static ssize_t thinros_dev_splice_read(struct file *filp, loff_t *ppos,
+		struct pipe_inode_info *pipe, size_t len, unsigned int flags)
+{
+	struct thinros_shm_channel * shm = ((struct thinros_shm_agent *) filp->private_data)->shm;
+	struct page *pages[PIPE_DEF_BUFFERS];
+	struct partial_page partial[PIPE_DEF_BUFFERS];
+	struct splice_pipe_desc spd = {
+		.pages = pages,
+		.partial = partial,
+		.nr_pages_max = PIPE_DEF_BUFFERS,
+		.ops = &thinros_pipe_buf_ops,
+		.spd_release = thinros_spd_release,
+	};
+	loff_t off = *ppos;
+	size_t chunk;
+	ssize_t ret;
+
+	if ((size_t) NONSECURE_PARTITION_SIZE <= off)
+	{
+		return 0;
 	}
+	if (!pfn_valid((shm->paddr + off) >> PAGE_SHIFT))
+	{
+		return copy_splice_read(filp, ppos, pipe, len, flags);
+	}
+	len = min(len, (size_t) NONSECURE_PARTITION_SIZE - (size_t) off);
+	while (len > 0 && spd.nr_pages < PIPE_DEF_BUFFERS
+		&& pfn_valid((shm->paddr + off) >> PAGE_SHIFT))
+	{
+		chunk = min(len, (size_t) (PAGE_SIZE - offset_in_page(off)));
+		pages[spd.nr_pages] = pfn_to_page((shm->paddr + off) >> PAGE_SHIFT);
+		get_page(pages[spd.nr_pages]);
+		partial[spd.nr_pages].offset = offset_in_page(off);
+		partial[spd.nr_pages].len = chunk;
+		spd.nr_pages++;
+		off += chunk;
+		len -= chunk;
+	}
+	ret = splice_to_pipe(pipe, &spd);
+	if (ret > 0)
+	{
+		*ppos += ret;
+	}
+	return ret;
 }
 
-static int thinros_pfs_release(struct inode *inode, struct file *filp)
+#else
+
+#define thinros_dev_splice_read	copy_splice_read
+
+#endif /* THINROS_SPLICE_PAGES */
+
+static int thinros_dev_release(struct inode *inode, struct file *filp)
 {
 	struct thinros_shm_agent * agent;
-	debug("thinros_pfs_release file closed\n");
+	debug("thinros_dev_release file closed\n");
 	agent = filp->private_data;
 	if (agent != NULL)
 	{
@@ -308,26 +577,250 @@ static int thinros_pfs_release(struct inode *inode, struct file *filp)
 	return 0;
 }
 
-static const proc_ops_init(fops,
-	thinros_pfs_open,
-	thinros_pfs_read, 
-	thinros_pfs_write, 
-	thinros_pfs_release, 
-	thinros_pfs_mmap);
+/* partition `idx` of the region, NULL if out of the region */
+static struct topic_partition_t * thinros_shm_partition(struct thinros_shm_channel * shm, __u32 idx)
+{
+	if (idx >= NONSECURE_PARTITION_SIZE / sizeof(struct topic_partition_t))
+	{
+		return NULL;
+	}
+	return (struct topic_partition_t *) shm->vaddr + idx;
+}
+
+/*
+ * the registry of an initialized partition, NULL if it is not laid out (yet).
+ * the partition is writable by user space, so *n gets the items claimed
+ * bounded by what fits in the topic buffer behind the registry, whatever
+ * the registry says its capacity is.
+ */
+static struct topic_registry_t * thinros_shm_registry(struct topic_partition_t * par, size_t * n)
+{
+	relative_addr_t off;
+	struct topic_registry_t * reg;
+	size_t cap;
+
+	if (smp_load_acquire(&par->status) == PARTITION_UNINITIALIZED)
+	{
+		return NULL;
+	}
+	off = READ_ONCE(par->registry);
+	if (off >= TOPIC_BUFFER_SIZE - sizeof(struct topic_registry_t))
+	{
+		return NULL;
+	}
+	reg = (struct topic_registry_t *) &par->topic_buffer[off];
+	cap = (TOPIC_BUFFER_SIZE - off - sizeof(struct topic_registry_t))
+		/ sizeof(struct topic_registry_item_t);
+	*n = min_t(size_t, __atomic_load_n(&reg->n, __ATOMIC_ACQUIRE),
+		min_t(size_t, READ_ONCE(reg->max_topics), cap));
+	return reg;
+}
+
+static __u64 thinros_shm_ring(struct thinros_shm_channel * shm, struct topic_partition_t * par,
+		relative_addr_t ring)
+{
+	if (ring >= TOPIC_BUFFER_SIZE)
+	{
+		return THINROS_IOC_NO_RING;
+	}
+	return (uint8_t *) &par->topic_buffer[ring] - (uint8_t *) shm->vaddr;
+}
+
+static long thinros_ioc_status(struct thinros_shm_channel * shm, struct thinros_ioc_status * st)
+{
+	struct topic_partition_t * par = thinros_shm_partition(shm, st->partition);
+	struct topic_registry_t * reg;
+	size_t n = 0;
+
+	if (par == NULL)
+	{
+		return -EINVAL;
+	}
+	st->status = smp_load_acquire(&par->status);
+	st->version = par->version;
+	reg = thinros_shm_registry(par, &n);
+	st->topics = n;
+	st->max_topics = reg != NULL ? reg->max_topics : 0;
+	st->reserved = reg != NULL ? par->allocator.base : 0;
+	st->brk = reg != NULL ? __atomic_load_n(&par->allocator.brk, __ATOMIC_RELAXED) : 0;
+	st->in_use = reg != NULL ? __atomic_load_n(&par->allocator.in_use, __ATOMIC_RELAXED) : 0;
+	return 0;
+}
+
+static long thinros_ioc_topic(struct thinros_shm_channel * shm, struct thinros_ioc_topic * t)
+{
+	struct topic_partition_t * par = thinros_shm_partition(shm, t->partition);
+	struct topic_registry_t * reg;
+	struct topic_registry_item_t * item;
+	size_t i, n;
+
+	if (par == NULL)
+	{
+		return -EINVAL;
+	}
+	reg = thinros_shm_registry(par, &n);
+	if (reg == NULL)
+	{
+		return -ENOENT;
+	}
+	/* a linear walk, the ioctl is not on a data path */
+	for (i = 0; i < n; i++)
+	{
+		item = &reg->topic[i];
+		if (smp_load_acquire(&item->ready) && READ_ONCE(item->uuid) == t->uuid)
+		{
+			t->flags = (READ_ONCE(item->to_publish) ? THINROS_IOC_PUBLISHED : 0)
+				| (READ_ONCE(item->to_subscribe) ? THINROS_IOC_SUBSCRIBED : 0);
+			t->length = READ_ONCE(item->length);
+			t->elem_sz = READ_ONCE(item->elem_sz);
+			t->local_ring = thinros_shm_ring(shm, par, READ_ONCE(item->local_ring));
+			t->external_ring = thinros_shm_ring(shm, par, READ_ONCE(item->external_ring));
+			/* as allocated by the library, 0 if it cannot fit */
+			if (t->length > TOPIC_BUFFER_SIZE || t->elem_sz > TOPIC_BUFFER_SIZE)
+			{
+				t->ring_size = 0;
+			}
+			else
+			{
+				t->ring_size = sizeof(struct topic_ring_t)
+					+ t->length * (sizeof(struct topic_data_t) + t->elem_sz)
+					+ PADDING_BYTES;
+			}
+			return 0;
+		}
+	}
+	return -ENOENT;
+}
+
+static long thinros_dev_ioctl(struct file *filp, unsigned int cmd, unsigned long arg)
+{
+	struct thinros_shm_channel * shm = ((struct thinros_shm_agent *) filp->private_data)->shm;
+	void __user * uarg = (void __user *) arg;
+	long err;
+
+	switch (cmd)
+	{
+	case THINROS_IOC_GEOMETRY:
+	{
+		struct thinros_ioc_geometry g = {
+			.region = shm->id,
+			.n_partitions = NONSECURE_PARTITION_SIZE / sizeof(struct topic_partition_t),
+			.region_size = NONSECURE_PARTITION_SIZE,
+			.partition_size = sizeof(struct topic_partition_t),
+			.topic_buffer = offsetof(struct topic_partition_t, topic_buffer),
+		};
+		return copy_to_user(uarg, &g, sizeof(g)) ? -EFAULT : 0;
+	}
+	case THINROS_IOC_STATUS:
+	{
+		struct thinros_ioc_status st;
+		if (copy_from_user(&st, uarg, sizeof(st)))
+		{
+			return -EFAULT;
+		}
+		err = thinros_ioc_status(shm, &st);
+		return err != 0 ? err : copy_to_user(uarg, &st, sizeof(st)) ? -EFAULT : 0;
+	}
+	case THINROS_IOC_TOPIC:
+	{
+		struct thinros_ioc_topic t;
+		if (copy_from_user(&t, uarg, sizeof(t)))
+		{
+			return -EFAULT;
+		}
+		err = thinros_ioc_topic(shm, &t);
+		return err != 0 ? err : copy_to_user(uarg, &t, sizeof(t)) ? -EFAULT : 0;
+	}
+	default:
+		return -ENOTTY;
+	}
+}
+
+static const struct file_operations fops = {
+	.owner          = THIS_MODULE,
+	.open           = thinros_dev_open,
+	.read           = thinros_dev_read,
+	.read_iter      = thinros_dev_read_iter,
+	.splice_read    = thinros_dev_splice_read,
+	.write          = thinros_dev_write,
+	.release        = thinros_dev_release,
+	.mmap           = thinros_dev_mmap,
+	.unlocked_ioctl = thinros_dev_ioctl,
+	/* the arguments have the same layout in 32-bit processes */
+	.compat_ioctl   = thinros_dev_ioctl,
+};
 
 static int thinros_dev_init(void)
 {
+	unsigned int i;
+	int err = 0;
+
 	debug("start to load thinros kernel module...\n");
-	proc_create(n_devname, 0666, NULL, &fops);
-	shm.paddr = NONSECURE_PARTITION_LOC;
-	atomic_set(&shm.ref_count, 0);
-	atomic_set(&shm.total, 1);
-	return 0;
+	if (partitions < 1 || partitions > n_max_partitions
+		|| (n_paddrs != 0 && n_paddrs != partitions))
+	{
+		info("partitions=%u needs 1 - %d partitions and one address each in paddrs\n",
+			partitions, n_max_partitions);
+		return -EINVAL;
+	}
+	for (i = 0; i < partitions; i++)
+	{
+		struct thinros_shm_channel * shm = &shms[i];
+
+		shm->id = i;
+		shm->paddr = n_paddrs != 0 ? paddrs[i]
+			: NONSECURE_PARTITION_LOC + i * NONSECURE_PARTITION_SIZE;
+		atomic_set(&shm->ref_count, 0);
+		atomic_set(&shm->total, 1);
+		if (i == 0)
+		{
+			snprintf(shm->name, sizeof(shm->name), "%s", n_devname);
+		}
+		else
+		{
+			snprintf(shm->name, sizeof(shm->name), "%s%u", n_devname, i);
+		}
+		shm->vaddr = memremap(shm->paddr, NONSECURE_PARTITION_SIZE, MEMREMAP_WB);
+		if (shm->vaddr == NULL)
+		{
+			info("cannot map partition %u at 0x%lx\n", i, shm->paddr);
+			err = -ENOMEM;
+			break;
+		}
+		shm->misc.minor = MISC_DYNAMIC_MINOR;
+		shm->misc.name = shm->name;
+		shm->misc.fops = &fops;
+		shm->misc.mode = 0666;
+		err = misc_register(&shm->misc);
+		if (err)
+		{
+			info("error %d: cannot register /dev/%s\n", err, shm->name);
+			memunmap(shm->vaddr);
+			break;
+		}
+		info("partition %u at 0x%lx: /dev/%s\n", i, shm->paddr, shm->name);
+	}
+	if (err)
+	{
+		/* undo the partitions registered */
+		while (i-- > 0)
+		{
+			misc_deregister(&shms[i].misc);
+			memunmap(shms[i].vaddr);
+		}
+	}
+	return err;
 }
 
 static void thinros_dev_exit(void)
 {
-	remove_proc_entry(n_devname, NULL);
+	unsigned int i;
+
+	for (i = 0; i < partitions; i++)
+	{
+		misc_deregister(&shms[i].misc);
+		memunmap(shms[i].vaddr);
+	}
 	debug("thinros kernel module exit!\n");
 }
 
@@ -4,6 +4,7 @@
 #include "lib/thinros_cfg.h"
 
 #define n_devname				"thinros"
-#define n_devpath				"/proc/" n_devname
+#define n_devpath				"/dev/" n_devname
+#define n_max_partitions		(8)	/* /dev/thinros, /dev/thinros1, ... */
 
 #endif /* !_THINROS_CONFIG_H_ */
@@ -0,0 +1,164 @@
+#ifndef _THINROS_HPP_
+#define _THINROS_HPP_
+
+/*
+ * compile-time topic resolution for C++ clients.
+ *
+ * topic names are resolved against the scenario namespace (THINROS_TOPICS in
+ * thinros_cfg.h) while compiling, so registration goes straight to the uuid
+ * and a misspelled topic or a message type larger than the topic elements is
+ * a build error. a namespace loaded into the partition at runtime
+ * (thinros_load_namespace) has to keep the uuids of the compiled-in one.
+ *
+ *     thinros::advertise<"drv_steer", msg_steer_t>(pub, node);
+ *     thinros::publish<"drv_steer">(pub, steer);
+ *     thinros::subscribe<"drv_steer", msg_steer_t>(sub, node, on_steer);
+ */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "thinros_core.h"
+
+namespace thinros
+{
+
+/* string literal as a template argument */
+template <size_t N>
+struct topic_name
+{
+    char value[N];
+
+    constexpr topic_name(const char (&s)[N])
+    {
+        for (size_t i = 0; i < N; i++)
+        {
+            value[i] = s[i];
+        }
+    }
+
+    constexpr std::string_view view() const { return { value, N - 1 }; }
+};
+
+struct topic_info
+{
+    std::string_view name;
+    size_t           uuid;
+    size_t           length;
+    size_t           elem_sz;
+    uint64_t         hash;
+};
+
+/* same FNV-1a as topic_name_hash() */
+constexpr uint64_t
+name_hash(std::string_view name)
+{
+    uint64_t h = 0xcbf29ce484222325llu;
+    for (size_t i = 0; i < name.size() && i < TOPIC_NAME_SIZE; i++)
+    {
+        h ^= (uint8_t)name[i];
+        h *= 0x100000001b3llu;
+    }
+    return h;
+}
+
+#define THINROS_TOPIC_INFO(topic, id, len, type) \
+    topic_info { #topic, id, len, sizeof(type), name_hash(#topic) },
+#define THINROS_TOPIC_COUNT(topic, id, len, type) +1
+
+inline constexpr std::array<topic_info, 0 THINROS_TOPICS(THINROS_TOPIC_COUNT)>
+    topics = { { THINROS_TOPICS(THINROS_TOPIC_INFO) } };
+
+#undef THINROS_TOPIC_INFO
+#undef THINROS_TOPIC_COUNT
+
+inline constexpr size_t npos = static_cast<size_t>(-1);
+
+constexpr size_t
+find_topic(std::string_view name)
+{
+    uint64_t h = name_hash(name);
+    for (size_t i = 0; i < topics.size(); i++)
+    {
+        if (topics[i].hash == h && topics[i].name == name)
+        {
+            return i;
+        }
+    }
+    return npos;
+}
+
+constexpr bool
+topics_unique()
+{
+    for (size_t i = 0; i < topics.size(); i++)
+    {
+        for (size_t j = i + 1; j < topics.size(); j++)
+        {
+            if (topics[i].uuid == topics[j].uuid
+                || topics[i].name == topics[j].name)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static_assert(topics_unique(), "duplicate topic name or uuid in THINROS_TOPICS");
+
+template <topic_name Name>
+struct topic
+{
+    static constexpr size_t index = find_topic(Name.view());
+    static_assert(index != npos, "topic is not defined in the scenario namespace");
+
+    static constexpr topic_info info
+        = index < topics.size() ? topics[index] : topic_info {};
+    static constexpr size_t uuid    = info.uuid;
+    static constexpr size_t length  = info.length;
+    static constexpr size_t elem_sz = info.elem_sz;
+};
+
+template <topic_name Name, typename Msg>
+constexpr void
+check_message()
+{
+    static_assert(sizeof(Msg) <= topic<Name>::elem_sz,
+        "message type does not fit the element size of the topic");
+}
+
+template <topic_name Name, typename Msg>
+inline void
+advertise(publisher_t& publisher, node_handle_t& n)
+{
+    check_message<Name, Msg>();
+    thinros_advertise_uuid(&publisher, &n, topic<Name>::uuid);
+}
+
+template <topic_name Name, typename Msg>
+inline void
+publish(publisher_t& publisher, const Msg& message)
+{
+    check_message<Name, Msg>();
+    thinros_publish(&publisher, const_cast<Msg*>(&message), sizeof(Msg));
+}
+
+template <topic_name Name, typename Msg>
+inline void
+subscribe(subscriber_t& subscriber, node_handle_t& n,
+    thinros_callback_on_t callback, thinros_priority_t priority = PRIO_NORMAL,
+    uint64_t deadline = NO_DEADLINE)
+{
+    check_message<Name, Msg>();
+    static_assert(topic<Name>::elem_sz <= MAX_MESSAGE_SIZE,
+        "topic elements do not fit the receive buffer of a node");
+    thinros_subscribe_uuid(
+        &subscriber, &n, topic<Name>::uuid, callback, priority, deadline);
+}
+
+} /* namespace thinros */
+
+#endif /* !_THINROS_HPP_ */
@@ -1,43 +1,25 @@
 #include "thinros_core.h"
+#include "thinros_layout.h"
 
-#if (TROS_SCENARIO_SAFETY_CONTROLLER)
-struct topic_namespace_t topic_namespace =
-{
-	.n = 3,
-	.topic = {
-		{.name = "drv_steer",     .uuid = 1, .length = 32, .elem_sz = sizeof(msg_steer_t)},
-		{.name = "drv_throttle",  .uuid = 2, .length = 32, .elem_sz = sizeof(msg_throttle_t)},
-		{.name = "fwd_scan",      .uuid = 3, .length = 16, .elem_sz = sizeof(msg_lidar_t)},
-		/* ... (MAX_TOPICS) */
-	},
-};
-#endif /* TROS_SCENARIO_SAFETY_CONTROLLER */
+#define TOPIC_NAMESPACE_ITEM(topic, id, len, type) \
+    {.name = #topic, .uuid = id, .length = len, .elem_sz = sizeof(type)},
+#define TOPIC_NAMESPACE_COUNT(topic, id, len, type) +1
 
-#if (TROS_SCENARIO_BENCH_INTRA_PARTITION)
+/* topics of the selected scenario, see THINROS_TOPICS in thinros_cfg.h */
 struct topic_namespace_t topic_namespace =
 {
-	.n = 7,
-	.topic = {
-		{.name = "benchmark_4",       .uuid = 0, .length = 16, .elem_sz = sizeof(msg_benchmark_sz_4_t)},
-		{.name = "benchmark_16",      .uuid = 1, .length = 16, .elem_sz = sizeof(msg_benchmark_sz_16_t)},
-		{.name = "benchmark_64",      .uuid = 2, .length = 16, .elem_sz = sizeof(msg_benchmark_sz_64_t)},
-		{.name = "benchmark_256",     .uuid = 3, .length = 16, .elem_sz = sizeof(msg_benchmark_sz_256_t)},
-		{.name = "benchmark_1K",      .uuid = 4, .length = 16, .elem_sz = sizeof(msg_benchmark_sz_1K_t)},
-		{.name = "benchmark_4K",      .uuid = 5, .length = 16, .elem_sz = sizeof(msg_benchmark_sz_4K_t)},
-		{.name = "benchmark_results", .uuid = 6, .length = 4, .elem_sz = sizeof(msg_benchmark_results_t)},
-	},
+    .n = 0 THINROS_TOPICS(TOPIC_NAMESPACE_COUNT),
+    .topic = {
+        THINROS_TOPICS(TOPIC_NAMESPACE_ITEM)
+    },
 };
-#endif /* TROS_SCENARIO_BENCH_INTRA_PARTITION */
 
-#if (TROS_SCENARIO_SECURE_GATEWAY)
-struct topic_namespace_t topic_namespace =
+/* rings of the scenario at fixed offsets, stamped by topic_partition_init */
+struct topic_layout_t topic_layout =
 {
-    .n = 4,
+    .n = THINROS_LAYOUT_TOPICS,
+    .size = THINROS_LAYOUT_SIZE,
     .topic = {
-        {.name = "mav_gateway_out", .uuid = 0, .length = 511, .elem_sz = sizeof(msg_mavlink_t)},
-        {.name = "mav_gateway_in",  .uuid = 1, .length = 511, .elem_sz = sizeof(msg_mavlink_t)},
-        {.name = "cipher_text", .uuid = 2, .length = 16, .elem_sz = sizeof(encryption_service_t)},
-        {.name = "enc_request",  .uuid = 3, .length = 16, .elem_sz = sizeof(encryption_service_t)},
+        THINROS_TOPICS(THINROS_LAYOUT_ITEM)
     },
 };
-#endif /* TROS_SCENARIO_SECURE_GATEWAY */
@@ -13,17 +13,27 @@
 
 #define TOPIC_BUFFER_SIZE			(4 * _1m)
 #define MAX_MESSAGE_SIZE			(512lu)
-#define MAX_TOPICS					(8lu)
-#define MAX_TOPICS_SUBSCRIBE		(8lu) /* max number of topics allows to subscribe for each node */
+#ifndef MAX_TOPICS
+#define MAX_TOPICS					(8lu) /* power of 2, compiled-in namespace capacity */
+#endif
 #define MAX_TOPICS_PUBLISH			(8lu)
 #define TOPIC_NAME_SIZE				(32lu)
-#define MAX_RING_ELEMS				(512lu) /* max number of elements a topic could buffer */
 #define NODE_NAME_SIZE				(32lu)
 #define PADDING_BYTES				(32lu)
-#define MAX_PARTITIONS				(4lu)
+/* partition limits used by topic_partition_init, see topic_partition_limits_t */
+#define DEFAULT_PARTITION_TOPICS	(64lu)  /* topics a partition can register */
+#define DEFAULT_RING_ELEMS			(512lu) /* max number of elements a topic could buffer */
 #define INVALID_TOPIC_UUID			(0lu)
+#define TOPIC_REGISTER_TIMEOUT		(10lu * 1000 * 1000) /* ns to wait for another registration of a uuid */
+#define TOPIC_REGISTRY_LOG			(256lu) /* power of 2, wiring changes the master catches up on one by one */
+#define TIMER_WHEEL_LEVELS			(4lu)
+#define TIMER_WHEEL_BITS			(6lu)  /* 64 slots per level */
+#define TIMER_TICK_SHIFT			(16lu) /* tick = 2^16 ns (~65 us) */
+#define HIST_SUB_BITS				(3lu)  /* 8 linear buckets per power of 2 */
+#define HIST_MAX_BITS				(40lu) /* values up to 2^40 ns (~18 min) */
 
 extern struct topic_namespace_t topic_namespace;
+extern struct topic_layout_t topic_layout;
 
 
 #ifndef __cplusplus
@@ -120,5 +130,37 @@ typedef struct
     unsigned int value[1024];
 } msg_benchmark_sz_4K_t;
 
+/*
+ * scenario namespaces: X(name, uuid, length, message type) per topic.
+ * expanded into `topic_namespace` by thinros_cfg.c and resolved at compile
+ * time by lib/thinros.hpp.
+ */
+#if (TROS_SCENARIO_SAFETY_CONTROLLER)
+#define THINROS_TOPICS(X)                  \
+    X(drv_steer,    1, 32, msg_steer_t)    \
+    X(drv_throttle, 2, 32, msg_throttle_t) \
+    X(fwd_scan,     3, 16, msg_lidar_t)
+
+#elif (TROS_SCENARIO_BENCH_INTRA_PARTITION)
+#define THINROS_TOPICS(X)                                \
+    X(benchmark_4,       0, 16, msg_benchmark_sz_4_t)    \
+    X(benchmark_16,      1, 16, msg_benchmark_sz_16_t)   \
+    X(benchmark_64,      2, 16, msg_benchmark_sz_64_t)   \
+    X(benchmark_256,     3, 16, msg_benchmark_sz_256_t)  \
+    X(benchmark_1K,      4, 16, msg_benchmark_sz_1K_t)   \
+    X(benchmark_4K,      5, 16, msg_benchmark_sz_4K_t)   \
+    X(benchmark_results, 6, 4,  msg_benchmark_results_t)
+
+#elif (TROS_SCENARIO_SECURE_GATEWAY)
+#define THINROS_TOPICS(X)                             \
+    X(mav_gateway_out, 0, 511, msg_mavlink_t)         \
+    X(mav_gateway_in,  1, 511, msg_mavlink_t)         \
+    X(cipher_text,     2, 16,  encryption_service_t)  \
+    X(enc_request,     3, 16,  encryption_service_t)
+
+#else
+/* no scenario selected, topics can only be added at runtime */
+#define THINROS_TOPICS(X)
+#endif
 
 #endif /* !_THINROS_CFG_H_ */
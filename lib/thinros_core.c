@@ -1,5 +1,106 @@
 #include "thinros_core.h"
 
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+struct thinros_clock_t thinros_clock;
+
+#if defined(__x86_64__)
+static bool
+thinros_clock_tsc_invariant(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+    {
+        return false;
+    }
+    return (edx & (1u << 8)) != 0;
+}
+#endif
+
+/**
+ * pick the clock source and compute the cycle to nanosecond factor. the first
+ * caller calibrates, concurrent callers wait for it to publish the result.
+ */
+void
+thinros_clock_init(void)
+{
+    enum thinros_clock_source_t expected = CLOCK_SOURCE_UNCALIBRATED;
+    struct thinros_clock_t      c        = { .source = CLOCK_SOURCE_FALLBACK };
+
+    if (!__atomic_compare_exchange_n(&thinros_clock.source, &expected,
+            CLOCK_SOURCE_CALIBRATING, false, __ATOMIC_ACQUIRE,
+            __ATOMIC_ACQUIRE))
+    {
+        while (__atomic_load_n(&thinros_clock.source, __ATOMIC_ACQUIRE)
+               == CLOCK_SOURCE_CALIBRATING)
+        {
+        }
+        return;
+    }
+
+#if defined(__SIZEOF_INT128__) && defined(__aarch64__)
+    uint64_t freq;
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(freq));
+    if (freq != 0)
+    {
+        c.mult   = (1000000000llu << 32) / freq;
+        c.source = CLOCK_SOURCE_COUNTER;
+    }
+#elif defined(__SIZEOF_INT128__) && defined(__x86_64__)
+    if (thinros_clock_tsc_invariant())
+    {
+        /* calibrate over ~10 ms against CLOCK_MONOTONIC */
+        uint64_t ns0 = time_ns(), cy0 = thinros_cycles();
+        uint64_t ns1, cy1;
+        do
+        {
+            ns1 = time_ns();
+            cy1 = thinros_cycles();
+        } while (ns1 - ns0 < 10000000llu);
+        c.mult   = (uint64_t)((((unsigned __int128)(ns1 - ns0)) << 32)
+                            / (cy1 - cy0));
+        c.source = CLOCK_SOURCE_COUNTER;
+    }
+#endif
+
+    thinros_clock.base_ns     = time_ns();
+    thinros_clock.base_cycles = thinros_cycles();
+    thinros_clock.mult        = c.mult;
+    __atomic_store_n(&thinros_clock.source, c.source, __ATOMIC_RELEASE);
+}
+
+/* hand the calibration of this process to the processes attaching to `clk` */
+static void
+thinros_clock_publish(struct topic_partition_clock_t* clk)
+{
+    (void)thinros_now();
+    clk->base_cycles = thinros_clock.base_cycles;
+    clk->base_ns     = thinros_clock.base_ns;
+    __atomic_store_n(&clk->mult,
+        thinros_clock.source == CLOCK_SOURCE_COUNTER ? thinros_clock.mult : 0,
+        __ATOMIC_RELEASE);
+}
+
+/*
+ * take over the calibration published in `clk`, on the same counter. the
+ * process's other threads must not read the clock meanwhile.
+ */
+static void
+thinros_clock_adopt(struct topic_partition_clock_t* clk)
+{
+    uint64_t mult = __atomic_load_n(&clk->mult, __ATOMIC_ACQUIRE);
+
+    (void)thinros_now();
+    if (mult != 0 && thinros_clock.source == CLOCK_SOURCE_COUNTER)
+    {
+        thinros_clock.base_cycles = clk->base_cycles;
+        thinros_clock.base_ns     = clk->base_ns;
+        thinros_clock.mult        = mult;
+    }
+}
+
 /*-- debug functions --*/
 void
 topic_ring_print(struct topic_ring_t* r)
@@ -89,11 +190,10 @@ thinros_node_print(struct node_handle_t* n)
 {
     info("node `%s` partition 0x%lx, subscribing (%lu): ", n->node_name,
         (size_t)n->par, n->n_subscribers);
-    for (size_t i = 0; i < n->n_subscribers; i++)
+    for (struct subscriber_t* s = n->subscribers; s != NULL; s = s->next)
     {
-        struct subscriber_t*           s = n->subscribers[i];
-        struct topic_namespace_item_t* ns
-            = topic_namespace_query_by_uuid(s->topic_uuid);
+        struct topic_namespace_item_t* ns = topic_namespace_table_query_by_uuid(
+            topic_partition_namespace(n->par), s->topic_uuid);
         info("on topic `%s` (uuid: %lu, local 0x%lx external 0x%lx), ",
             ns->name, s->topic_uuid, (size_t)s->local_reader.ring,
             (size_t)s->external_reader.ring);
@@ -101,52 +201,197 @@ thinros_node_print(struct node_handle_t* n)
     info("\n");
 }
 
+void
+thinros_node_print_dispatch(struct node_handle_t* n)
+{
+    static const char* const names[MAX_PRIORITIES]
+        = { "low", "normal", "high", "critical" };
+    info("node `%s` dispatch (budget %lu ns):\n", n->node_name,
+        (size_t)n->budget);
+    for (size_t i = MAX_PRIORITIES; i-- > 0;)
+    {
+        struct thinros_dispatch_stats_t* st = &n->stats[i];
+        info("  [%-8s] dispatched %lu deferred %lu worst latency %lu ns\n",
+            names[i], st->dispatched, st->deferred, (size_t)st->worst);
+    }
+}
+
+void
+thinros_histogram_print(struct thinros_histogram_t* h)
+{
+    if (h->count == 0)
+    {
+        info("no samples\n");
+        return;
+    }
+    info("n %lu min %lu avg %lu p50 %lu p90 %lu p99 %lu p99.9 %lu max %lu "
+         "(ns)\n",
+        (size_t)h->count, (size_t)h->min, (size_t)(h->sum / h->count),
+        (size_t)thinros_histogram_percentile(h, 50.0),
+        (size_t)thinros_histogram_percentile(h, 90.0),
+        (size_t)thinros_histogram_percentile(h, 99.0),
+        (size_t)thinros_histogram_percentile(h, 99.9), (size_t)h->max);
+}
+
+void
+thinros_subscriber_print_latency(struct subscriber_t* s)
+{
+    info("subscriber 0x%lx topic %lu\n", (size_t)s, s->topic_uuid);
+    info("  delivery:    ");
+    thinros_histogram_print(&s->latency.delivery);
+    info("  replication: ");
+    thinros_histogram_print(&s->latency.replication);
+}
+
+void
+thinros_node_print_latency(struct node_handle_t* n)
+{
+    info("node `%s` latency:\n", n->node_name);
+    for (struct subscriber_t* s = n->subscribers; s != NULL; s = s->next)
+    {
+        thinros_subscriber_print_latency(s);
+    }
+}
+
 void
 topic_partition_print(struct topic_partition_t* par)
 {
-    info("partition 0x%lx id %lu topics:\n", (size_t)par, par->partition_id);
-    for (size_t i = 0; i < par->registry.n; i++)
+    struct topic_registry_t* reg = topic_partition_registry(par);
+    info("partition 0x%lx id %lu topics (%lu/%lu, ring elems <= %lu):\n",
+        (size_t)par, par->partition_id, reg->n, par->limits.max_topics,
+        par->limits.max_ring_elems);
+    for (size_t i = 0; i < reg->n; i++)
     {
-        struct topic_registry_item_t* t = &par->registry.topic[i];
+        struct topic_registry_item_t* t = topic_registry_at(reg, i);
+        if (t == NULL)
+        {
+            continue;
+        }
         info("  [uuid %8lu %c %c local 0x%lx external 0x%lx]\n", t->uuid,
             t->to_publish ? 'P' : ' ', t->to_subscribe ? 'S' : ' ',
             (size_t)t->local_ring, (size_t)t->external_ring);
     }
+
+    struct topic_partition_usage_t usage;
+    topic_partition_usage(par, &usage);
+    info("  buffer %lu: reserved %lu in use %lu released %lu available %lu, "
+         "rings %lu local %lu external\n",
+        usage.size, usage.reserved, usage.in_use, usage.released,
+        usage.available, usage.local_rings, usage.external_rings);
+}
+
+static void
+master_record_print(struct master_record_t* par)
+{
+    topic_partition_print(par->address);
+    info("==\n");
+    info("replicators (%lu), copied %lu, idle sources skipped %lu, "
+         "deferred %lu, dropped %lu, per switch ",
+        par->n_replicators, (size_t)par->stats.copied,
+        (size_t)par->stats.skipped, (size_t)par->stats.deferred,
+        (size_t)par->stats.dropped);
+    thinros_histogram_print(&par->stats.time);
+    for (size_t j = 0; j < par->n_replicators; j++)
+    {
+        struct topic_replicator_t* rep = par->replicators[j];
+        info("  topic uuid %lu (priority %u) -> ring @0x%lx, from:\n",
+            rep->topic_uuid, rep->priority, (size_t)rep->destination.ring);
+        for (size_t k = 0; k < rep->n_sources; k++)
+        {
+            struct topic_reader_t* src = &rep->sources[k];
+            info("    ring 0x%lx (partition %lu)\n", (size_t)src->ring,
+                rep->origins[k]);
+        }
+    }
 }
 
 void
 thinros_master_print(struct thinros_master_t* m)
 {
-    info("partitions (%lu):\n", m->n_partitions);
+    info("partitions (%lu/%lu), arena used %lu of %lu:\n", m->n_partitions,
+        m->max_partitions, m->arena.brk, m->arena.size);
     for (size_t i = 0; i < m->n_partitions; i++)
     {
-        struct master_record_t* par = &m->partitions[i];
         info("<par %lu:", i);
-        topic_partition_print(par->address);
-        info("==\n");
-        info("replicators (%lu):\n", par->n_replicators);
-        for (size_t j = 0; j < par->n_replicators; j++)
-        {
-            struct topic_replicator_t* rep = &par->replicators[j];
-            info("  topic uuid %lu -> ring @0x%lx, from:\n", rep->topic_uuid,
-                (size_t)rep->destination.ring);
-            for (size_t k = 0; k < rep->n_sources; k++)
-            {
-                struct topic_reader_t* src = &rep->sources[k];
-                info("    ring 0x%lx\n", (size_t)src->ring);
-            }
-        }
+        master_record_print(&m->partitions[i]);
+    }
+    if (m->broadcast.address != NULL && m->broadcast.wiring != NULL)
+    {
+        info("<broadcast:");
+        master_record_print(&m->broadcast);
     }
 }
 
 /*-- end of debug functions --*/
 
+void
+thinros_histogram_reset(struct thinros_histogram_t* h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+static size_t
+thinros_histogram_index(uint64_t v)
+{
+    if (v < HIST_SUB_BUCKETS)
+    {
+        return v;
+    }
+    size_t msb   = 63 - __builtin_clzll(v);
+    size_t shift = msb - HIST_SUB_BITS;
+    size_t idx   = (shift + 1) * HIST_SUB_BUCKETS
+               + ((v >> shift) & (HIST_SUB_BUCKETS - 1));
+    return MIN(idx, HIST_BUCKETS - 1);
+}
+
+/* largest value counted in bucket `idx` */
+static uint64_t
+thinros_histogram_value(size_t idx)
+{
+    if (idx < HIST_SUB_BUCKETS)
+    {
+        return idx;
+    }
+    size_t shift = idx / HIST_SUB_BUCKETS - 1;
+    size_t sub   = idx % HIST_SUB_BUCKETS;
+    return ((HIST_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void
+thinros_histogram_record(struct thinros_histogram_t* h, uint64_t v)
+{
+    h->bucket[thinros_histogram_index(v)]++;
+    h->count++;
+    h->sum += v;
+    h->min  = MIN(h->min, v);
+    h->max  = MAX(h->max, v);
+}
+
+uint64_t
+thinros_histogram_percentile(struct thinros_histogram_t* h, double p)
+{
+    uint64_t rank = (uint64_t)(h->count * p / 100.0 + 0.5);
+    uint64_t seen = 0;
+    size_t   i;
+
+    rank = MAX(rank, (uint64_t)1);
+    for (i = 0; i < HIST_BUCKETS; i++)
+    {
+        seen += h->bucket[i];
+        if (seen >= rank)
+        {
+            return MIN(thinros_histogram_value(i), h->max);
+        }
+    }
+    return h->max;
+}
+
 void
 topic_ring_init(struct topic_ring_t* p_ring, size_t n, size_t elem_sz)
 {
     ASSERT(p_ring != NULL);
     ASSERT(((uintptr_t) p_ring) % 8 == 0); /* ensure ring is 8-byte aligned */
-    ASSERT(n <= MAX_RING_ELEMS);
 
     size_t               i;
     struct topic_ring_t* r = p_ring;
@@ -160,18 +405,31 @@ topic_ring_init(struct topic_ring_t* p_ring, size_t n, size_t elem_sz)
     }
 }
 
-size_t
-topic_ring_alloc(struct topic_ring_t* r)
+/* take `k` consecutive slots with one fetch_add, the sequence of the first */
+static size_t
+topic_ring_reserve(struct topic_ring_t* r, size_t k)
 {
     ASSERT(r != NULL);
     ASSERT(r->n != 0 && "ring is not initialized.");
+    ASSERT(k <= r->n);
 
-    size_t               loc  = atomic_fetch_add(&r->head, 1);
-    size_t               idx  = loc % r->n;
-    struct topic_data_t* data = of(r, idx);
-    atomic_store(&data->status, TOPIC_EMPTY);
-    data->timestamp = loc;
-    return idx;
+    size_t loc = atomic_fetch_add(&r->head, k);
+    for (size_t i = loc; i < loc + k; i++)
+    {
+        struct topic_data_t* data = of(r, i % r->n);
+        atomic_store(&data->status, TOPIC_EMPTY);
+        data->origin     = TOPIC_ORIGIN_LOCAL;
+        data->timestamp  = i;
+        data->published  = 0;
+        data->replicated = 0;
+    }
+    return loc;
+}
+
+size_t
+topic_ring_alloc(struct topic_ring_t* r)
+{
+    return topic_ring_reserve(r, 1) % r->n;
 }
 
 static void
@@ -207,6 +465,12 @@ topic_writer_complete(struct topic_writer_t* w)
     ASSERT(w != NULL);
     ASSERT(w->ring != NULL);
 
+    struct topic_data_t* data = of(w->ring, w->index);
+    if (data->published == 0)
+    {
+        /* a fresh message, copies keep the original publish time */
+        data->published = thinros_now();
+    }
     topic_ring_mk_ready(w->ring, w->index);
 }
 
@@ -222,14 +486,20 @@ topic_writer_write(struct topic_writer_t* w, void* src, size_t sz)
     return data;
 }
 
+/**
+ * @param read_ring status of each ring element, at least r->n entries
+ */
 void
-topic_reader_init(struct topic_reader_t* rd, struct topic_ring_t* r)
+topic_reader_init(struct topic_reader_t* rd, struct topic_ring_t* r,
+    enum topic_reader_data_status_t* read_ring)
 {
+    ASSERT(read_ring != NULL);
     rd->read_head = 0;
     rd->read_tail = 0;
     rd->index     = 0;
     rd->timestamp = 0;
     rd->ring      = r;
+    rd->read_ring = read_ring;
 }
 
 static void
@@ -309,45 +579,60 @@ topic_reader_read_eager(struct topic_reader_t* rd)
     return data;
 }
 
-bool
-topic_reader_complete(struct topic_reader_t* rd)
+/* move the tail past the elements read */
+static void
+topic_reader_advance(struct topic_reader_t* rd)
 {
-    size_t               i;
-    size_t               n    = rd->ring->n;
-    struct topic_data_t* data = of(rd->ring, rd->index);
-    /* check if the data has been overwritten during the reading */
-    bool                 consistent
-        = (data->status == TOPIC_READY && data->timestamp == rd->timestamp);
-    rd->read_ring[rd->index] = READER_HAS_READ;
+    size_t i;
     for (i = rd->read_tail; i < rd->read_head; i++)
     {
-        if (rd->read_ring[i % n] == READER_NOT_READ)
+        if (rd->read_ring[i % rd->ring->n] == READER_NOT_READ)
         {
             break;
         }
     }
     /* now i = next to ready elem or head */
     rd->read_tail = i;
+}
+
+bool
+topic_reader_complete(struct topic_reader_t* rd)
+{
+    struct topic_data_t* data = of(rd->ring, rd->index);
+    /* check if the data has been overwritten during the reading */
+    bool                 consistent
+        = (data->status == TOPIC_READY && data->timestamp == rd->timestamp);
+    rd->read_ring[rd->index] = READER_HAS_READ;
+    topic_reader_advance(rd);
 
     return consistent;
 }
 
-/**
- * read all available messages
- *
- * @param rd
- * @param buffer (temporary) should be larger than one message size
- * @param callback
- * @return
- */
-size_t
-topic_reader_read_all(struct topic_reader_t* rd, void* buffer, size_t sz,
-    thinros_callback_on_t callback)
+static void
+topic_reader_record(
+    struct thinros_latency_t* lat, uint64_t published, uint64_t replicated)
+{
+    uint64_t now = thinros_now();
+    thinros_histogram_record(
+        &lat->delivery, now > published ? now - published : 0);
+    if (replicated != 0)
+    {
+        thinros_histogram_record(&lat->replication,
+            replicated > published ? replicated - published : 0);
+    }
+}
+
+/* messages with origin `skip` are marked read without a callback */
+static size_t
+topic_reader_dispatch(struct topic_reader_t* rd, void* buffer, size_t sz,
+    thinros_callback_on_t callback, struct thinros_latency_t* lat, size_t skip)
 {
     ASSERT(callback != NULL);
 
     topic_reader_sync(rd);
     size_t total_read = 0;
+    size_t payload    = rd->ring->elem_sz - sizeof(struct topic_data_t);
+    ASSERT(payload <= sz);
 
     for (size_t i = rd->read_tail; i < rd->read_head; i++)
     {
@@ -355,13 +640,24 @@ topic_reader_read_all(struct topic_reader_t* rd, void* buffer, size_t sz,
         struct topic_data_t* cur = of(rd->ring, idx);
         if (cur->status == TOPIC_READY && rd->read_ring[idx] == READER_NOT_READ)
         {
-            rd->index     = idx;
-            rd->timestamp = cur->timestamp;
-            ASSERT(rd->ring->elem_sz < sz);
-            memcpy(buffer, cur->data, MIN(sz, rd->ring->elem_sz));
+            rd->index           = idx;
+            rd->timestamp       = cur->timestamp;
+            if (cur->origin == skip)
+            {
+                /* published in the reader's partition, read there */
+                topic_reader_complete(rd);
+                continue;
+            }
+            uint64_t published  = cur->published;
+            uint64_t replicated = cur->replicated;
+            memcpy(buffer, cur->data, payload);
             bool succ = topic_reader_complete(rd);
             if (succ)
             {
+                if (lat != NULL)
+                {
+                    topic_reader_record(lat, published, replicated);
+                }
                 callback(buffer);
                 total_read++;
             }
@@ -376,8 +672,44 @@ topic_reader_read_all(struct topic_reader_t* rd, void* buffer, size_t sz,
     return total_read;
 }
 
+/**
+ * read all available messages
+ *
+ * @param rd
+ * @param buffer (temporary) should be larger than one message size
+ * @param callback
+ * @return
+ */
 size_t
-topic_ring_copy(struct topic_reader_t* rd, struct topic_writer_t* wr)
+topic_reader_read_all(struct topic_reader_t* rd, void* buffer, size_t sz,
+    thinros_callback_on_t callback)
+{
+    return topic_reader_dispatch(rd, buffer, sz, callback, NULL, (size_t)-1);
+}
+
+/* ready and not copied yet */
+static bool
+topic_ring_copyable(struct topic_reader_t* rd, size_t i)
+{
+    size_t idx = i % rd->ring->n;
+    return (of(rd->ring, idx))->status == TOPIC_READY
+        && rd->read_ring[idx] == READER_NOT_READ;
+}
+
+/**
+ * copy the new messages of `rd` to the ring of `wr`, at most `max` slots;
+ * the others stay for the next copy. consecutive ready slots are copied as a
+ * run: the destination slots are reserved at once and the run shares one
+ * timestamp and one update of the reader's tail. every slot still takes its
+ * own memcpy, its header (and ready flag) sits between the payloads and may
+ * only be set once the payload is in. the copies carry `origin`. no run
+ * starts at or after `deadline` (thinros_now(), 0: none).
+ *
+ * @return messages copied
+ */
+static size_t
+topic_ring_copy_max(struct topic_reader_t* rd, struct topic_writer_t* wr,
+    size_t max, uint64_t deadline, uint32_t origin)
 {
     ASSERT(rd != NULL);
     ASSERT(wr != NULL);
@@ -385,37 +717,92 @@ topic_ring_copy(struct topic_reader_t* rd, struct topic_writer_t* wr)
     ASSERT(rd->ring->elem_sz == wr->ring->elem_sz);
 
     topic_reader_sync(rd);
-    size_t copied = 0;
-    size_t sz     = wr->ring->elem_sz;
+    size_t   copied = 0, taken = 0;
+    size_t   sz     = wr->ring->elem_sz - sizeof(struct topic_data_t);
+    size_t   i, j, k, loc;
+    uint64_t now;
 
-    for (size_t i = rd->read_tail; i < rd->read_head; i++)
+    for (i = rd->read_tail; i < rd->read_head && taken < max; i = j)
     {
-        size_t               idx = i % rd->ring->n;
-        struct topic_data_t* src = of(rd->ring, idx);
-        if (src->status == TOPIC_READY && rd->read_ring[idx] == READER_NOT_READ)
+        for (j = i; j < rd->read_head && j - i < wr->ring->n
+                    && j - i < max - taken && topic_ring_copyable(rd, j);
+             j++)
+        {
+        }
+        if (j == i)
+        {
+            /* not ready yet or copied, look again on the next copy */
+            j++;
+            continue;
+        }
+
+        now = thinros_now();
+        if (deadline != 0 && now >= deadline)
+        {
+            break;
+        }
+        loc = topic_ring_reserve(wr->ring, j - i);
+        taken += j - i;
+        for (k = 0; k < j - i; k++)
         {
-            rd->index                = idx;
-            rd->timestamp            = src->timestamp;
-            struct topic_data_t* dst = topic_writer_next_avail(wr);
+            size_t               idx = (i + k) % rd->ring->n;
+            struct topic_data_t* src = of(rd->ring, idx);
+            struct topic_data_t* dst = of(wr->ring, (loc + k) % wr->ring->n);
+
+            dst->origin     = origin;
+            dst->published  = src->published;
+            dst->replicated = now;
             memcpy(dst->data, src->data, sz);
-            bool succ = topic_reader_complete(rd);
-            if (succ)
+            rd->read_ring[idx] = READER_HAS_READ;
+            /* check if the data has been overwritten during the copy */
+            if (src->status == TOPIC_READY && src->timestamp == i + k)
             {
-                topic_writer_complete(wr);
+                topic_ring_mk_ready(wr->ring, (loc + k) % wr->ring->n);
                 copied++;
             }
             else
             {
                 WARN("message %lu in topic ring 0x%lx copy failed due to "
                      "overwrite.\n",
-                    i, (size_t)rd->ring);
+                    i + k, (size_t)rd->ring);
             }
         }
+        rd->index     = (j - 1) % rd->ring->n;
+        rd->timestamp = (of(rd->ring, rd->index))->timestamp;
+        wr->index     = (loc + k - 1) % wr->ring->n;
     }
+    topic_reader_advance(rd);
 
     return (copied);
 }
 
+/**
+ * copy all the new messages of `rd` to the ring of `wr`
+ *
+ * @return messages copied
+ */
+size_t
+topic_ring_copy(struct topic_reader_t* rd, struct topic_writer_t* wr)
+{
+    return topic_ring_copy_max(rd, wr, (size_t)-1, 0, TOPIC_ORIGIN_LOCAL);
+}
+
+/* messages of the ring overwritten before `rd` got to them */
+static size_t
+topic_reader_lost(struct topic_reader_t* rd)
+{
+    size_t hd   = atomic_load(&rd->ring->head);
+    size_t n    = rd->ring->n;
+    size_t tl   = hd > n ? hd - n : 0;
+    size_t lost = tl > rd->read_head ? tl - rd->read_head : 0;
+
+    for (size_t i = rd->read_tail; i < MIN(rd->read_head, tl); i++)
+    {
+        lost += rd->read_ring[i % n] == READER_NOT_READ;
+    }
+    return lost;
+}
+
 bool
 topic_reader_read(struct topic_reader_t* rd, void* dest, size_t sz)
 {
@@ -445,7 +832,7 @@ linear_allocator_init(struct linear_allocator_t* la, size_t total_sz)
     atomic_store(&la->brk, 0);
 }
 
-relative_addr_t
+size_t
 linear_allocator_alloc(struct linear_allocator_t* la, size_t sz)
 {
     /* ensure we only allocate on 8-byte aligned addresses */
@@ -455,462 +842,2866 @@ linear_allocator_alloc(struct linear_allocator_t* la, size_t sz)
         sz += 8 - align_off;
     }
 
-    ASSERT(sz < la->size - la->brk);
+    ASSERT(sz < la->size - la->brk && "out of memory!");
 
     size_t loc = atomic_fetch_add(&la->brk, sz);
     return (loc);
 }
 
-static void
-linear_allocator_used(struct linear_allocator_t* la)
+uint64_t
+topic_name_hash(const char* name)
 {
-    info("used %lu (%lu %%)\n", la->brk, la->brk * 100 / la->size);
+    /* FNV-1a */
+    uint64_t h = 0xcbf29ce484222325llu;
+    size_t   i;
+    for (i = 0; i < TOPIC_NAME_SIZE && name[i] != '\0'; i++)
+    {
+        h ^= (uint8_t)name[i];
+        h *= 0x100000001b3llu;
+    }
+    return h;
 }
 
-struct topic_namespace_item_t*
-topic_namespace_query_by_name(char* name)
+static gcc_inline size_t
+topic_uuid_hash(size_t uuid)
 {
-    size_t                         i;
-    struct topic_namespace_item_t* ns = NULL;
-    for (i = 0; i < topic_namespace.n; i++)
-    {
-        if (strncmp(name, topic_namespace.topic[i].name, TOPIC_NAME_SIZE) == 0)
-        {
-            ns = &topic_namespace.topic[i];
-            break;
-        }
-    }
-    return ns;
+    /* fibonacci hashing, the high bits are the well mixed ones */
+    return (size_t)(((uint64_t)uuid * 0x9e3779b97f4a7c15llu) >> 32);
 }
 
-struct topic_namespace_item_t*
-topic_namespace_query_by_uuid(size_t uuid)
+static gcc_inline size_t
+topic_name_bucket(uint64_t h, size_t n_buckets)
 {
-    size_t                         i;
-    struct topic_namespace_item_t* ns = NULL;
-    for (i = 0; i < topic_namespace.n; i++)
-    {
-        if (topic_namespace.topic[i].uuid == uuid)
-        {
-            ns = &topic_namespace.topic[i];
-            break;
-        }
-    }
-    return ns;
+    return (size_t)(h >> 40) % n_buckets;
 }
 
-static void
-topic_registry_init(struct topic_registry_t* reg)
+static gcc_inline size_t
+topic_name_slot(uint64_t h, size_t d, size_t n_slots)
 {
-    reg->n = 0;
+    /* odd stride: d = 0 .. n_slots-1 visits every slot once */
+    return ((size_t)(uint32_t)h + d * (size_t)((h >> 32) | 1)) & (n_slots - 1);
 }
 
-static struct topic_registry_item_t*
-topic_registry_insert(struct topic_registry_t* reg, size_t uuid,
-    relative_addr_t local_ring, relative_addr_t external_ring)
+static gcc_inline uint16_t*
+topic_namespace_displace(struct topic_namespace_table_t* t)
+{
+    return (uint16_t*)((uintptr_t)t + t->index_off);
+}
+
+static gcc_inline uint16_t*
+topic_namespace_by_name(struct topic_namespace_table_t* t)
 {
-    ASSERT(reg->n < MAX_TOPICS);
-    size_t idx = atomic_fetch_add(&reg->n, 1);
-    ASSERT(idx < MAX_TOPICS && "too many topics!");
+    return topic_namespace_displace(t) + t->max_topics;
+}
 
-    reg->topic[idx].uuid          = uuid;
-    reg->topic[idx].local_ring    = local_ring;
-    reg->topic[idx].external_ring = external_ring;
-    reg->topic[idx].to_publish    = FALSE;
-    reg->topic[idx].to_subscribe  = FALSE;
-    return &reg->topic[idx];
+static gcc_inline uint16_t*
+topic_namespace_by_uuid(struct topic_namespace_table_t* t)
+{
+    return topic_namespace_by_name(t) + t->max_slots;
 }
 
-struct topic_registry_item_t*
-topic_registry_query(struct topic_registry_t* reg, size_t uuid)
+static size_t
+topic_namespace_max_slots(size_t max_topics)
 {
-    ASSERT(reg != NULL);
-    struct topic_registry_item_t* item = NULL;
-    size_t                        i;
-    size_t                        n = reg->n < MAX_TOPICS ? reg->n : MAX_TOPICS;
-    for (i = 0; i < n; i++)
+    size_t slots;
+    for (slots = 4; slots < 4 * max_topics; slots <<= 1)
     {
-        if (reg->topic[i].uuid == uuid)
-        {
-            item = &reg->topic[i];
-            break;
-        }
     }
-
-    return item;
+    return slots;
 }
 
-void
-topic_partition_init(struct topic_partition_t* par)
+static size_t
+topic_namespace_align(size_t sz)
 {
-    topic_registry_init(&par->registry);
-    linear_allocator_init(&par->allocator, TOPIC_BUFFER_SIZE);
-    par->status = PARTITION_INITIALIZED;
+    return (sz + 7) & ~(size_t)7;
 }
 
-static uintptr_t
-topic_partition_get_addr(struct topic_partition_t* par, relative_addr_t ra)
+size_t
+topic_namespace_table_size(size_t max_topics)
 {
-    ASSERT(ra < TOPIC_BUFFER_SIZE);
-    return (uintptr_t)(&par->topic_buffer[ra]);
+    size_t slots = topic_namespace_max_slots(max_topics);
+    return sizeof(struct topic_namespace_table_t)
+         + max_topics * sizeof(struct topic_namespace_item_t)
+         + topic_namespace_align((max_topics + 2 * slots) * sizeof(uint16_t))
+         /* build scratch: hashes, then start, fill, members and order */
+         + max_topics * sizeof(uint64_t)
+         + topic_namespace_align((4 * max_topics + 1) * sizeof(uint16_t));
 }
 
-static relative_addr_t
-topic_partition_to_relative(struct topic_partition_t* par, uintptr_t addr)
+void
+topic_namespace_table_init(struct topic_namespace_table_t* t, size_t max_topics)
 {
-    ASSERT((uintptr_t)par->topic_buffer <= addr);
-    ASSERT(addr < (uintptr_t)par + sizeof(struct topic_partition_t));
-    return (relative_addr_t)(addr - (uintptr_t)&par->topic_buffer);
+    ASSERT(t != NULL);
+    ASSERT(max_topics > 0 && max_topics < UINT16_MAX);
+
+    atomic_store(&t->built, 0);
+    t->n          = 0;
+    t->max_topics = max_topics;
+    t->max_slots  = topic_namespace_max_slots(max_topics);
+    t->n_buckets  = 1;
+    t->n_slots    = 0;
+    t->index_off  = sizeof(struct topic_namespace_table_t)
+                 + max_topics * sizeof(struct topic_namespace_item_t);
+}
+
+/**
+ * append a topic, the index has to be (re)built before lookups see it
+ *
+ * @return false if the table is full, the name is too long or the name or
+ * uuid is taken
+ */
+bool
+topic_namespace_table_add(struct topic_namespace_table_t* t, const char* name,
+    size_t uuid, size_t length, size_t elem_sz)
+{
+    size_t i;
+
+    if (t->n == t->max_topics || strnlen(name, TOPIC_NAME_SIZE) == TOPIC_NAME_SIZE)
+    {
+        return false;
+    }
+    for (i = 0; i < t->n; i++)
+    {
+        if (t->topic[i].uuid == uuid
+            || strncmp(t->topic[i].name, name, TOPIC_NAME_SIZE) == 0)
+        {
+            return false;
+        }
+    }
+
+    struct topic_namespace_item_t* item = &t->topic[t->n];
+    memset(item->name, 0, TOPIC_NAME_SIZE);
+    memcpy(item->name, name, strnlen(name, TOPIC_NAME_SIZE));
+    item->uuid    = uuid;
+    item->length  = length;
+    item->elem_sz = elem_sz;
+    t->n++;
+    return true;
+}
+
+/**
+ * place the names `members[0..k)` of bucket `b` at displacement `d` if all
+ * their slots are free and distinct
+ */
+static bool
+topic_namespace_index_place(struct topic_namespace_table_t* t,
+    uint64_t* hashes, uint16_t* members, size_t k, size_t b, size_t d)
+{
+    uint16_t* by_name = topic_namespace_by_name(t);
+    size_t    i, j;
+    for (i = 0; i < k; i++)
+    {
+        size_t slot = topic_name_slot(hashes[members[i]], d, t->n_slots);
+        if (by_name[slot] != 0)
+        {
+            /* collision, roll back */
+            for (j = 0; j < i; j++)
+            {
+                by_name[topic_name_slot(hashes[members[j]], d, t->n_slots)] = 0;
+            }
+            return false;
+        }
+        by_name[slot] = members[i] + 1;
+    }
+    topic_namespace_displace(t)[b] = d;
+    return true;
+}
+
+static bool
+topic_namespace_index_try(
+    struct topic_namespace_table_t* t, uint64_t* hashes, size_t n_slots)
+{
+    size_t    n       = t->n;
+    uint16_t* start   = (uint16_t*)(hashes + t->max_topics);
+    uint16_t* fill    = start + t->max_topics + 1;
+    uint16_t* members = fill + t->max_topics;
+    uint16_t* order   = members + t->max_topics;
+    size_t    i, b, d, size, k;
+
+    t->n_slots   = n_slots;
+    t->n_buckets = MAX(n / 2, (size_t)1);
+    memset(topic_namespace_by_name(t), 0, n_slots * sizeof(uint16_t));
+    memset(topic_namespace_displace(t), 0, t->max_topics * sizeof(uint16_t));
+
+    /* group the names by bucket */
+    memset(start, 0, (t->n_buckets + 1) * sizeof(uint16_t));
+    for (i = 0; i < n; i++)
+    {
+        start[topic_name_bucket(hashes[i], t->n_buckets) + 1]++;
+    }
+    for (b = 0; b < t->n_buckets; b++)
+    {
+        start[b + 1] += start[b];
+        fill[b]       = start[b];
+    }
+    for (i = 0; i < n; i++)
+    {
+        members[fill[topic_name_bucket(hashes[i], t->n_buckets)]++] = i;
+    }
+
+    /* largest buckets first, they are the hardest to place */
+    for (k = 0, size = n; size > 0; size--)
+    {
+        for (b = 0; b < t->n_buckets; b++)
+        {
+            if ((size_t)(start[b + 1] - start[b]) == size)
+            {
+                order[k++] = b;
+            }
+        }
+        if (k == t->n_buckets)
+        {
+            break;
+        }
+    }
+
+    for (i = 0; i < k; i++)
+    {
+        b = order[i];
+        for (d = 0; d < t->n_slots; d++)
+        {
+            if (topic_namespace_index_place(t, hashes, &members[start[b]],
+                    start[b + 1] - start[b], b, d))
+            {
+                break;
+            }
+        }
+        if (d == t->n_slots)
+        {
+            return false;
+        }
+    }
+    return true;
 }
 
+/**
+ * (re)build the lookup index over the topics added so far
+ */
 void
-topic_nonsecure_partition_init(struct topic_partition_t* par)
+topic_namespace_table_build(struct topic_namespace_table_t* t)
+{
+    size_t    n      = t->n;
+    uint64_t* hashes = (uint64_t*)(topic_namespace_by_uuid(t) + t->max_slots);
+    size_t    i, n_slots;
+
+    hashes = (uint64_t*)topic_namespace_align((uintptr_t)hashes);
+    atomic_store(&t->built, 0);
+    for (i = 0; i < n; i++)
+    {
+        hashes[i] = topic_name_hash(t->topic[i].name);
+    }
+    for (n_slots = 2; n_slots < 2 * n; n_slots <<= 1)
+    {
+    }
+    while (!topic_namespace_index_try(t, hashes, n_slots))
+    {
+        n_slots <<= 1;
+        ASSERT(n_slots <= t->max_slots && "cannot build topic index!");
+    }
+
+    uint16_t* by_uuid = topic_namespace_by_uuid(t);
+    memset(by_uuid, 0, n_slots * sizeof(uint16_t));
+    for (i = 0; i < n; i++)
+    {
+        size_t slot = topic_uuid_hash(t->topic[i].uuid);
+        while (by_uuid[slot & (n_slots - 1)] != 0)
+        {
+            slot++;
+        }
+        by_uuid[slot & (n_slots - 1)] = i + 1;
+    }
+    atomic_store(&t->built, MAX(n, (size_t)1));
+}
+
+struct topic_namespace_item_t*
+topic_namespace_table_query_by_name(
+    struct topic_namespace_table_t* t, const char* name)
+{
+    uint64_t h    = topic_name_hash(name);
+    size_t   b    = topic_name_bucket(h, t->n_buckets);
+    size_t   slot = topic_name_slot(h, topic_namespace_displace(t)[b], t->n_slots);
+    size_t   i    = topic_namespace_by_name(t)[slot];
+
+    if (i == 0 || strncmp(name, t->topic[i - 1].name, TOPIC_NAME_SIZE) != 0)
+    {
+        return NULL;
+    }
+    return &t->topic[i - 1];
+}
+
+struct topic_namespace_item_t*
+topic_namespace_table_query_by_uuid(struct topic_namespace_table_t* t, size_t uuid)
+{
+    uint16_t* by_uuid = topic_namespace_by_uuid(t);
+    size_t    slot, i;
+
+    for (slot = topic_uuid_hash(uuid);; slot++)
+    {
+        i = by_uuid[slot & (t->n_slots - 1)];
+        if (i == 0)
+        {
+            return NULL;
+        }
+        if (t->topic[i - 1].uuid == uuid)
+        {
+            return &t->topic[i - 1];
+        }
+    }
+}
+
+#define TOPIC_NAMESPACE_COMPILED_SIZE                                      \
+    (sizeof(struct topic_namespace_table_t)                                \
+        + MAX_TOPICS * (sizeof(struct topic_namespace_item_t) + 64) + 32)
+
+/* table of the compiled-in namespace, built from `topic_namespace` */
+static uint64_t topic_namespace_compiled_table[TOPIC_NAMESPACE_COMPILED_SIZE / 8];
+
+/**
+ * (re)build the table of the compiled-in namespace. lookups build it on first
+ * use; call it again after changing `topic_namespace`.
+ */
+void
+topic_namespace_index_build(void)
+{
+    struct topic_namespace_table_t* t
+        = (struct topic_namespace_table_t*)topic_namespace_compiled_table;
+    size_t i;
+
+    ASSERT(topic_namespace_table_size(MAX_TOPICS)
+           <= sizeof(topic_namespace_compiled_table));
+    ASSERT(topic_namespace.n <= MAX_TOPICS);
+    topic_namespace_table_init(t, MAX_TOPICS);
+    for (i = 0; i < topic_namespace.n; i++)
+    {
+        struct topic_namespace_item_t* item = &topic_namespace.topic[i];
+        if (!topic_namespace_table_add(t, item->name, item->uuid, item->length,
+                item->elem_sz))
+        {
+            WARN("topic `%s` [uuid=%lu] is defined twice.\n", item->name,
+                item->uuid);
+        }
+    }
+    topic_namespace_table_build(t);
+}
+
+struct topic_namespace_table_t*
+topic_namespace_compiled(void)
+{
+    static atomic_t(bool) building;
+    struct topic_namespace_table_t* t
+        = (struct topic_namespace_table_t*)topic_namespace_compiled_table;
+
+    if (unlikely(atomic_load(&t->built) == 0))
+    {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&building, &expected, true))
+        {
+            topic_namespace_index_build();
+        }
+        while (atomic_load(&t->built) == 0)
+        {
+            /* another thread is building the index */
+        }
+    }
+    return t;
+}
+
+struct topic_namespace_item_t*
+topic_namespace_query_by_name(const char* name)
+{
+    return topic_namespace_table_query_by_name(topic_namespace_compiled(), name);
+}
+
+struct topic_namespace_item_t*
+topic_namespace_query_by_uuid(size_t uuid)
+{
+    return topic_namespace_table_query_by_uuid(topic_namespace_compiled(), uuid);
+}
+
+static size_t
+topic_registry_index_slots(size_t max_topics)
+{
+    size_t slots;
+    /* load <= 1/2 after the index is full */
+    for (slots = 4; slots < 2 * max_topics; slots <<= 1)
+    {
+    }
+    return slots;
+}
+
+static size_t
+topic_registry_size(size_t max_topics)
+{
+    return sizeof(struct topic_registry_t)
+         + max_topics * sizeof(struct topic_registry_item_t)
+         + topic_registry_index_slots(max_topics)
+               * sizeof(struct topic_registry_slot_t);
+}
+
+static void
+topic_registry_init(struct topic_registry_t* reg, size_t max_topics)
 {
-    linear_allocator_init(&par->allocator, TOPIC_BUFFER_SIZE);
+    size_t g;
+
+    atomic_store(&reg->n, 0);
+    atomic_store(&reg->generation, 0);
+    for (g = 0; g < TOPIC_REGISTRY_LOG; g++)
+    {
+        /* a generation before the first, read as not logged yet */
+        atomic_store(&reg->log[g], (uint64_t)(uint32_t)(g - TOPIC_REGISTRY_LOG)
+                                       << 32);
+    }
+    reg->max_topics  = max_topics;
+    reg->index_slots = topic_registry_index_slots(max_topics);
+    reg->index_off   = sizeof(struct topic_registry_t)
+                   + max_topics * sizeof(struct topic_registry_item_t);
+    memset(topic_registry_index(reg), 0,
+        reg->index_slots * sizeof(struct topic_registry_slot_t));
 }
 
+/*
+ * the item of a claimed slot, waits while its process fills it in. NULL if
+ * that takes longer than TOPIC_REGISTER_TIMEOUT: the process died or stalls
+ * between claiming the slot and publishing the item.
+ */
 static struct topic_registry_item_t*
-topic_partition_register(
-    struct topic_partition_t* par, struct topic_namespace_item_t* ns)
+topic_registry_wait(
+    struct topic_registry_t* reg, struct topic_registry_slot_t* slot)
 {
-    ASSERT(par != NULL);
-    ASSERT(ns != NULL);
-    relative_addr_t      ra_local_ring, ra_ext_ring;
-    struct topic_ring_t *lr, *er;
+    uint64_t start = thinros_now();
+    uint32_t i;
+
+    while ((i = __atomic_load_n(&slot->item, __ATOMIC_ACQUIRE)) == 0)
+    {
+        if (thinros_now() - start > TOPIC_REGISTER_TIMEOUT)
+        {
+            WARN("topic [uuid=%lu] registration never completed.\n",
+                (size_t)(slot->key - 1));
+            return NULL;
+        }
+    }
+    return i == TOPIC_REGISTRY_FULL ? NULL : &reg->topic[i - 1];
+}
 
-    size_t sz = sizeof(struct topic_ring_t)
-              + ((sizeof(struct topic_data_t) + ns->elem_sz) * ns->length)
-              + PADDING_BYTES;
+/* take the next free item, bounded by the capacity */
+static size_t
+topic_registry_claim_item(struct topic_registry_t* reg)
+{
+    size_t idx = atomic_load(&reg->n);
+    do
+    {
+        if (idx >= reg->max_topics)
+        {
+            return reg->max_topics;
+        }
+    } while (!atomic_compare_exchange_weak(&reg->n, &idx, idx + 1));
+    return idx;
+}
 
-    ra_local_ring = linear_allocator_alloc(&par->allocator, sz);
-    ra_ext_ring   = linear_allocator_alloc(&par->allocator, sz);
+/**
+ * register `uuid`, or return its item if another process got there first.
+ * the uuid is claimed with a CAS on its index slot, the item is filled in and
+ * then published with a release store, so no process sees a half-written item
+ * or registers a uuid twice. registrations of different uuids never wait on
+ * each other; one racing for the same uuid waits for the winner to publish,
+ * see topic_registry_wait(). NULL if the registry is full.
+ *
+ * items are never given back, so a full registry stays full: a uuid is not
+ * claimed once it is, and a claim that loses the race for the last item
+ * leaves a tombstone, which probes pass over like a taken slot.
+ */
+static struct topic_registry_item_t*
+topic_registry_insert(struct topic_registry_t* reg, size_t uuid,
+    size_t length, size_t elem_sz, relative_addr_t local_ring,
+    relative_addr_t external_ring)
+{
+    struct topic_registry_slot_t* index = topic_registry_index(reg);
+    size_t                        h, idx, probes;
 
-    lr = (struct topic_ring_t*)topic_partition_get_addr(par, ra_local_ring);
-    er = (struct topic_ring_t*)topic_partition_get_addr(par, ra_ext_ring);
+    h = topic_uuid_hash(uuid);
+    for (probes = 0; probes < reg->index_slots; probes++, h++)
+    {
+        struct topic_registry_slot_t* slot = &index[h & (reg->index_slots - 1)];
+        uint64_t key = __atomic_load_n(&slot->key, __ATOMIC_ACQUIRE);
 
-    topic_ring_init(lr, ns->length, ns->elem_sz);
-    topic_ring_init(er, ns->length, ns->elem_sz);
-    struct topic_registry_item_t* topic = topic_registry_insert(
-        &par->registry, ns->uuid, ra_local_ring, ra_ext_ring);
+        if (key == 0 && atomic_load(&reg->n) >= reg->max_topics)
+        {
+            break;
+        }
+        if (key == 0
+            && __atomic_compare_exchange_n(&slot->key, &key,
+                topic_registry_key(uuid), false, __ATOMIC_ACQ_REL,
+                __ATOMIC_ACQUIRE))
+        {
+            /* the uuid is ours */
+            idx = topic_registry_claim_item(reg);
+            if (idx == reg->max_topics)
+            {
+                /* waiters for the uuid see FULL, later probes go past */
+                __atomic_store_n(&slot->item, TOPIC_REGISTRY_FULL,
+                    __ATOMIC_RELEASE);
+                __atomic_store_n(&slot->key, TOPIC_REGISTRY_TOMBSTONE,
+                    __ATOMIC_RELEASE);
+                break;
+            }
 
-    return topic;
+            struct topic_registry_item_t* item = &reg->topic[idx];
+            item->uuid          = uuid;
+            item->length        = length;
+            item->elem_sz       = elem_sz;
+            item->local_ring    = local_ring;
+            item->external_ring = external_ring;
+            item->cursors       = INVALID_RELATIVE_ADDR;
+            item->to_publish    = FALSE;
+            item->to_subscribe  = FALSE;
+            item->priority      = PRIO_LOW;
+            item->broadcast     = FALSE;
+            __atomic_store_n(&item->ready, TRUE, __ATOMIC_RELEASE);
+            __atomic_store_n(&slot->item, (uint32_t)idx + 1, __ATOMIC_RELEASE);
+            return item;
+        }
+        if (key == topic_registry_key(uuid))
+        {
+            /* registered by someone else, possibly right now */
+            return topic_registry_wait(reg, slot);
+        }
+    }
+    WARN("topic [uuid=%lu] registry full (%lu topics).\n", uuid,
+        reg->max_topics);
+    return NULL;
 }
 
+/**
+ * the item of `uuid`, NULL if not registered or still being registered
+ */
 struct topic_registry_item_t*
-topic_partition_get(struct topic_partition_t* par, size_t uuid)
+topic_registry_query(struct topic_registry_t* reg, size_t uuid)
 {
-    ASSERT(par != NULL);
+    ASSERT(reg != NULL);
+    struct topic_registry_slot_t* index = topic_registry_index(reg);
+    size_t                        h, probes;
 
-    struct topic_registry_item_t* topic = NULL;
-    topic = topic_registry_query(&par->registry, uuid);
-    if (topic != NULL)
+    h = topic_uuid_hash(uuid);
+    for (probes = 0; probes < reg->index_slots; probes++, h++)
     {
-        return topic;
+        struct topic_registry_slot_t* slot = &index[h & (reg->index_slots - 1)];
+        uint64_t key = __atomic_load_n(&slot->key, __ATOMIC_ACQUIRE);
+        if (key == 0)
+        {
+            return NULL;
+        }
+        if (key == topic_registry_key(uuid))
+        {
+            uint32_t i = __atomic_load_n(&slot->item, __ATOMIC_ACQUIRE);
+            return i == 0 || i == TOPIC_REGISTRY_FULL ? NULL
+                                                       : &reg->topic[i - 1];
+        }
     }
-    /* not found, create one */
-    struct topic_namespace_item_t* ns = topic_namespace_query_by_uuid(uuid);
-    if (ns == NULL)
+    return NULL;
+}
+
+/* tell the master that `topic` changed, see topic_registry_t */
+static void
+topic_registry_changed(
+    struct topic_registry_t* reg, struct topic_registry_item_t* topic)
+{
+    size_t g = atomic_fetch_add(&reg->generation, 1);
+    atomic_store(&reg->log[g & (TOPIC_REGISTRY_LOG - 1)],
+        (uint64_t)g << 32 | (uint64_t)(topic - reg->topic));
+}
+
+/**
+ * set a wiring flag of `topic` (to_publish or to_subscribe) and tell the
+ * master, which rewires the partitions whose generation moved
+ */
+static void
+topic_registry_wire(struct topic_registry_t* reg,
+    struct topic_registry_item_t* topic, bool* flag, bool value)
+{
+    if (__atomic_load_n(flag, __ATOMIC_ACQUIRE) != value)
     {
-        /* no such topic */
-        WARN("topic [uuid=%lu] does not define.\n", uuid);
-        return NULL;
+        __atomic_store_n(flag, value, __ATOMIC_RELEASE);
+        topic_registry_changed(reg, topic);
+    }
+}
+
+/* raise the replication priority of `topic` to `priority`, telling the master */
+static void
+topic_registry_raise(struct topic_registry_t* reg,
+    struct topic_registry_item_t* topic, uint32_t priority)
+{
+    uint32_t p = __atomic_load_n(&topic->priority, __ATOMIC_ACQUIRE);
+    while (p < priority)
+    {
+        if (__atomic_compare_exchange_n(&topic->priority, &p, priority, false,
+                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            topic_registry_changed(reg, topic);
+            return;
+        }
     }
-    topic = topic_partition_register(par, ns);
-    return topic;
 }
 
+/**
+ * the item at `idx` for walks over the registry, NULL while it is written
+ */
 struct topic_registry_item_t*
-topic_partition_get_by_name(struct topic_partition_t* par, char* topic_name)
+topic_registry_at(struct topic_registry_t* reg, size_t idx)
 {
-    struct topic_namespace_item_t* ns
-        = topic_namespace_query_by_name(topic_name);
-    ASSERT(ns != NULL && "topic name not found!");
-    struct topic_registry_item_t* topic = topic_partition_get(par, ns->uuid);
-    ASSERT(topic != NULL && "cannot allocate topic ring locally!");
+    struct topic_registry_item_t* item = &reg->topic[idx];
+    return __atomic_load_n(&item->ready, __ATOMIC_ACQUIRE) ? item : NULL;
+}
 
-    return topic;
+static uintptr_t
+topic_partition_get_addr(struct topic_partition_t* par, relative_addr_t ra)
+{
+    ASSERT(ra < TOPIC_BUFFER_SIZE);
+    return (uintptr_t)(&par->topic_buffer[ra]);
 }
 
-void
-thinros_node(
-    struct node_handle_t* n, struct topic_partition_t* par, char* node_name)
+static relative_addr_t
+topic_partition_to_relative(struct topic_partition_t* par, uintptr_t addr)
+{
+    ASSERT((uintptr_t)par->topic_buffer <= addr);
+    ASSERT(addr < (uintptr_t)par + sizeof(struct topic_partition_t));
+    return (relative_addr_t)(addr - (uintptr_t)&par->topic_buffer);
+}
+
+struct topic_registry_t*
+topic_partition_registry(struct topic_partition_t* par)
+{
+    return (struct topic_registry_t*)topic_partition_get_addr(
+        par, par->registry);
+}
+
+static void
+topic_allocator_init(struct topic_allocator_t* a, size_t base, size_t size)
+{
+    size_t c;
+    a->size = size;
+    a->base = (base + 7) & ~7lu;
+    atomic_store(&a->brk, a->base);
+    atomic_store(&a->in_use, 0);
+    for (c = 0; c < TOPIC_ALLOC_CLASSES; c++)
+    {
+        atomic_store(&a->free[c], 0);
+    }
+    atomic_store(&a->retired, 0);
+}
+
+/**
+ * move the start of the releasable blocks up by `sz` bytes, for the tables
+ * set up before any block is allocated
+ */
+static relative_addr_t
+topic_allocator_reserve(struct topic_allocator_t* a, size_t sz)
+{
+    relative_addr_t ra = a->base;
+    ASSERT(atomic_load(&a->brk) == a->base && "blocks already allocated!");
+    a->base += (sz + 7) & ~7lu;
+    ASSERT(a->base <= a->size && "out of memory!");
+    atomic_store(&a->brk, a->base);
+    return ra;
+}
+
+static gcc_inline size_t
+topic_allocator_class(size_t sz)
+{
+    size_t shift;
+    if (sz <= (1lu << TOPIC_ALLOC_MIN_SHIFT))
+    {
+        return 0;
+    }
+    /* 2^shift < sz <= 2^(shift + 1), split in four classes */
+    shift = 63 - __builtin_clzl(sz - 1);
+    return (shift - TOPIC_ALLOC_MIN_SHIFT) * 4
+         + ((sz - (1lu << shift) + (1lu << (shift - 2)) - 1) >> (shift - 2));
+}
+
+static gcc_inline size_t
+topic_allocator_class_size(size_t c)
+{
+    size_t shift;
+    if (c == 0)
+    {
+        return 1lu << TOPIC_ALLOC_MIN_SHIFT;
+    }
+    shift = TOPIC_ALLOC_MIN_SHIFT + (c - 1) / 4;
+    return (1lu << shift) + (((c - 1) % 4 + 1) << (shift - 2));
+}
+
+/* pop a released block of class `c`, the tag in the head defeats ABA */
+static relative_addr_t
+topic_allocator_pop(struct topic_partition_t* par, size_t c)
+{
+    atomic_t(uint64_t)* list = &par->allocator.free[c];
+    uint64_t head = atomic_load(list), next;
+
+    while ((uint32_t)head != 0)
+    {
+        struct topic_block_t* b = (struct topic_block_t*)topic_partition_get_addr(
+            par, (uint32_t)head - 1);
+        next = (((head >> 32) + 1) << 32)
+             | (uint32_t)__atomic_load_n(&b->next, __ATOMIC_RELAXED);
+        if (atomic_compare_exchange_weak(list, &head, next))
+        {
+            return (uint32_t)head - 1;
+        }
+    }
+    return INVALID_RELATIVE_ADDR;
+}
+
+/**
+ * allocate `sz` bytes in the topic buffer, INVALID_RELATIVE_ADDR if the buffer
+ * is exhausted. safe to call from several processes at once.
+ */
+relative_addr_t
+topic_partition_alloc(struct topic_partition_t* par, size_t sz)
+{
+    struct topic_allocator_t* a = &par->allocator;
+    struct topic_block_t*     b;
+    relative_addr_t           ra;
+    size_t                    c, block_sz;
+
+    ASSERT(par != NULL);
+    if (sz > a->size - sizeof(struct topic_block_t))
+    {
+        return INVALID_RELATIVE_ADDR;
+    }
+    c        = topic_allocator_class(sz + sizeof(struct topic_block_t));
+    block_sz = topic_allocator_class_size(c);
+
+    ra = topic_allocator_pop(par, c);
+    if (ra == INVALID_RELATIVE_ADDR)
+    {
+        /* nothing to reuse, grow */
+        ra = atomic_load(&a->brk);
+        do
+        {
+            if (block_sz > a->size - ra)
+            {
+                WARN("topic buffer exhausted, %lu bytes requested.\n", sz);
+                return INVALID_RELATIVE_ADDR;
+            }
+        } while (!atomic_compare_exchange_weak(&a->brk, &ra, ra + block_sz));
+    }
+
+    atomic_fetch_add(&a->in_use, block_sz);
+    b             = (struct topic_block_t*)topic_partition_get_addr(par, ra);
+    b->size_class = c;
+    b->magic      = TOPIC_BLOCK_USED;
+    return ra + sizeof(struct topic_block_t);
+}
+
+/* push block `b` at `ra` on `list` */
+static void
+topic_allocator_push(volatile _Atomic(uint64_t)* list,
+    struct topic_block_t* b, relative_addr_t ra)
+{
+    uint64_t head = atomic_load(list), next;
+    do
+    {
+        __atomic_store_n(&b->next, (uint32_t)head, __ATOMIC_RELAXED);
+        next = (((head >> 32) + 1) << 32) | (uint32_t)(ra + 1);
+    } while (!atomic_compare_exchange_weak(list, &head, next));
+}
+
+/* the header of an allocated block, NULL for the reserved memory */
+static struct topic_block_t*
+topic_allocator_block(struct topic_partition_t* par, relative_addr_t ra)
+{
+    struct topic_block_t* b;
+
+    if (ra == INVALID_RELATIVE_ADDR
+        || ra < par->allocator.base + sizeof(struct topic_block_t))
+    {
+        return NULL;
+    }
+    b = (struct topic_block_t*)topic_partition_get_addr(
+        par, ra - sizeof(struct topic_block_t));
+    ASSERT(b->magic == TOPIC_BLOCK_USED && "double free or not a block!");
+    ASSERT(b->size_class < TOPIC_ALLOC_CLASSES);
+    return b;
+}
+
+/**
+ * release a block from topic_partition_alloc() to the free list of its
+ * class. the static rings and the tables below `base` are kept.
+ */
+void
+topic_partition_free(struct topic_partition_t* par, relative_addr_t ra)
+{
+    struct topic_allocator_t* a = &par->allocator;
+    struct topic_block_t*     b = topic_allocator_block(par, ra);
+
+    if (b == NULL)
+    {
+        return;
+    }
+    b->magic = TOPIC_BLOCK_FREE;
+    atomic_fetch_sub(&a->in_use, topic_allocator_class_size(b->size_class));
+    topic_allocator_push(
+        &a->free[b->size_class], b, ra - sizeof(struct topic_block_t));
+}
+
+/*
+ * park a block of a removed topic until the master has unwired the registry
+ * `generation`, see topic_partition_reclaim()
+ */
+static void
+topic_partition_retire(
+    struct topic_partition_t* par, relative_addr_t ra, size_t generation)
+{
+    struct topic_block_t* b = topic_allocator_block(par, ra);
+
+    if (b != NULL)
+    {
+        b->generation = generation;
+        topic_allocator_push(
+            &par->allocator.retired, b, ra - sizeof(struct topic_block_t));
+    }
+}
+
+/**
+ * release the blocks of removed topics retired up to registry `generation`,
+ * once nothing refers to them anymore. thinros_master_update() calls it with
+ * the generation it has wired, a partition without a master with the current
+ * one. not concurrently with itself.
+ *
+ * @return number of blocks released
+ */
+size_t
+topic_partition_reclaim(struct topic_partition_t* par, size_t generation)
+{
+    atomic_t(uint64_t)* list = &par->allocator.retired;
+    uint64_t            head = atomic_load(list);
+    size_t              n    = 0;
+
+    /* take the whole list, the later ones go back */
+    while ((uint32_t)head != 0
+           && !atomic_compare_exchange_weak(list, &head, (head >> 32) << 32))
+    {
+    }
+    while ((uint32_t)head != 0)
+    {
+        relative_addr_t       ra = (uint32_t)head - 1;
+        struct topic_block_t* b
+            = (struct topic_block_t*)topic_partition_get_addr(par, ra);
+
+        head = __atomic_load_n(&b->next, __ATOMIC_RELAXED);
+        if (b->generation <= generation)
+        {
+            topic_partition_free(par, ra + sizeof(struct topic_block_t));
+            n++;
+        }
+        else
+        {
+            topic_allocator_push(list, b, ra);
+        }
+    }
+    return n;
+}
+
+/**
+ * initialize the rings of a static layout and register them, in one pass
+ */
+static void
+topic_partition_stamp(
+    struct topic_partition_t* par, struct topic_layout_t* layout)
+{
+    struct topic_registry_t* reg = topic_partition_registry(par);
+    size_t                   i;
+
+    for (i = 0; i < layout->n; i++)
+    {
+        struct topic_layout_item_t* item = &layout->topic[i];
+        topic_ring_init(
+            (struct topic_ring_t*)topic_partition_get_addr(par, item->local_ring),
+            item->length, item->elem_sz);
+        /* the external ring comes with the first subscription */
+        topic_registry_insert(reg, item->uuid, item->length, item->elem_sz,
+            item->local_ring, INVALID_RELATIVE_ADDR);
+    }
+}
+
+/**
+ * stamp of the partition format: the shared structures and the compiled-in
+ * static layout. processes only attach to a partition with their own stamp.
+ */
+uint64_t
+topic_partition_version(void)
+{
+    const size_t format[] = {
+        THINROS_PARTITION_FORMAT,
+        TOPIC_BUFFER_SIZE,
+        sizeof(struct topic_partition_t),
+        sizeof(struct topic_registry_item_t),
+        sizeof(struct topic_registry_slot_t),
+        sizeof(struct topic_cursor_t),
+        sizeof(struct topic_ring_t),
+        sizeof(struct topic_data_t),
+        sizeof(struct topic_block_t),
+        sizeof(struct topic_namespace_item_t),
+        topic_layout.n,
+        topic_layout.size,
+    };
+    const uint8_t* p[] = { (const uint8_t*)format,
+        (const uint8_t*)topic_layout.topic };
+    const size_t   n[] = { sizeof(format),
+        topic_layout.n * sizeof(struct topic_layout_item_t) };
+    uint64_t       h   = 0xcbf29ce484222325llu;
+    size_t         i, j;
+
+    for (i = 0; i < 2; i++)
+    {
+        for (j = 0; j < n[i]; j++)
+        {
+            h ^= p[i][j];
+            h *= 0x100000001b3llu;
+        }
+    }
+    return h;
+}
+
+bool
+topic_partition_compatible(struct topic_partition_t* par)
+{
+    return par->status != PARTITION_UNINITIALIZED
+        && par->version == topic_partition_version();
+}
+
+/* copy `names` next to the registry and share it, see topic_partition_setup */
+static void
+topic_partition_setup_namespace(
+    struct topic_partition_t* par, const struct topic_namespace_table_t* names)
+{
+    struct topic_namespace_table_t* t;
+    size_t                          i;
+
+    ASSERT(names->n <= par->limits.max_topics);
+    t = (struct topic_namespace_table_t*)topic_partition_get_addr(par,
+        topic_allocator_reserve(&par->allocator,
+            topic_namespace_table_size(par->limits.max_topics)));
+    topic_namespace_table_init(t, par->limits.max_topics);
+    for (i = 0; i < names->n; i++)
+    {
+        topic_namespace_table_add(t, names->topic[i].name, names->topic[i].uuid,
+            names->topic[i].length, names->topic[i].elem_sz);
+    }
+    topic_namespace_table_build(t);
+    __atomic_store_n(&par->names,
+        topic_partition_to_relative(par, (uintptr_t)t), __ATOMIC_RELEASE);
+}
+
+/**
+ * lay out the partition for the given limits: the rings of `layout` (if any)
+ * at the start of the topic buffer, then the registry and the copy of `names`
+ * (if any); rings and reader state allocated later come after them.
+ */
+static void
+topic_partition_setup(struct topic_partition_t* par,
+    const struct topic_partition_limits_t* limits,
+    struct topic_layout_t*                 layout,
+    const struct topic_namespace_table_t*  names)
+{
+    ASSERT(par != NULL);
+    ASSERT(limits != NULL);
+    ASSERT(limits->max_topics > 0 && limits->max_ring_elems > 0);
+
+    par->limits = *limits;
+    /* the rings at the offsets computed at build time come first */
+    topic_allocator_init(&par->allocator,
+        layout != NULL ? layout->size : 0, TOPIC_BUFFER_SIZE);
+    par->registry = topic_allocator_reserve(
+        &par->allocator, topic_registry_size(limits->max_topics));
+    par->names    = INVALID_RELATIVE_ADDR;
+    par->version  = topic_partition_version();
+    thinros_clock_publish(&par->clock);
+    topic_registry_init(topic_partition_registry(par), limits->max_topics);
+    if (layout != NULL)
+    {
+        topic_partition_stamp(par, layout);
+    }
+    if (names != NULL)
+    {
+        topic_partition_setup_namespace(par, names);
+    }
+    /* processes attaching meanwhile wait for this, see thinros_bind() */
+    __atomic_store_n(&par->status, PARTITION_INITIALIZED, __ATOMIC_RELEASE);
+}
+
+/**
+ * empty partition sized by `limits`, topics are allocated on first use
+ */
+void
+topic_partition_init_limits(
+    struct topic_partition_t* par, const struct topic_partition_limits_t* limits)
+{
+    topic_partition_setup(par, limits, NULL, NULL);
+}
+
+/**
+ * empty partition sized by `limits` sharing the namespace `names` instead of
+ * the compiled-in one, e.g. one read by thinros_load_namespace(). the table
+ * is copied into the partition before any other process can attach.
+ */
+void
+topic_partition_init_namespace(struct topic_partition_t* par,
+    const struct topic_partition_limits_t* limits,
+    const struct topic_namespace_table_t*  names)
+{
+    ASSERT(names != NULL);
+    topic_partition_setup(par, limits, NULL, names);
+}
+
+/**
+ * partition with the default limits and the rings of the compiled-in
+ * scenario already in place, see thinros_layout.h
+ */
+void
+topic_partition_init(struct topic_partition_t* par)
+{
+    struct topic_partition_limits_t limits = TOPIC_PARTITION_DEFAULT_LIMITS;
+    topic_partition_setup(par, &limits, &topic_layout, NULL);
+}
+
+/**
+ * the namespace shared in the partition, or the compiled-in one if the
+ * initializing process did not install any
+ */
+struct topic_namespace_table_t*
+topic_partition_namespace(struct topic_partition_t* par)
+{
+    relative_addr_t ra = __atomic_load_n(&par->names, __ATOMIC_ACQUIRE);
+    if (ra == INVALID_RELATIVE_ADDR)
+    {
+        return topic_namespace_compiled();
+    }
+    return (struct topic_namespace_table_t*)topic_partition_get_addr(par, ra);
+}
+
+/**
+ * attach to a partition set up by topic_partition_init. registry, rings and
+ * allocator live in the partition, so a restarted process reuses the topics
+ * already registered as they are; see thinros_node_resume() for its readers.
+ * the process adopts the clock calibration of the partition, so the publish
+ * timestamps of the other processes compare with its own thinros_now().
+ */
+void
+topic_nonsecure_partition_init(struct topic_partition_t* par)
+{
+    ASSERT(par->status != PARTITION_UNINITIALIZED
+           && "partition is not initialized!");
+    ASSERT(topic_partition_compatible(par)
+           && "partition laid out by an incompatible build!");
+    thinros_clock_adopt(&par->clock);
+}
+
+/**
+ * the cursor of the `ordinal`-th subscription of node `node_name` to `topic`,
+ * with the reader state of both rings; a new one is pushed to the topic's
+ * list if the node never subscribed. `*found` tells which.
+ */
+static struct topic_cursor_t*
+topic_partition_cursor(struct topic_partition_t* par,
+    struct topic_registry_item_t* topic, const char* node_name, size_t ordinal,
+    bool* found)
+{
+    size_t          state = topic->length * sizeof(enum topic_reader_data_status_t);
+    relative_addr_t ra    = __atomic_load_n(&topic->cursors, __ATOMIC_ACQUIRE);
+    struct topic_cursor_t* c;
+
+    for (; ra != INVALID_RELATIVE_ADDR; ra = c->next)
+    {
+        c = (struct topic_cursor_t*)topic_partition_get_addr(par, ra);
+        if (c->ordinal == ordinal
+            && strncmp(c->node_name, node_name, NODE_NAME_SIZE - 1) == 0)
+        {
+            *found = TRUE;
+            return c;
+        }
+    }
+
+    ra = topic_partition_alloc(par, sizeof(struct topic_cursor_t) + 2 * state);
+    ASSERT(ra != INVALID_RELATIVE_ADDR && "out of memory!");
+    c = (struct topic_cursor_t*)topic_partition_get_addr(par, ra);
+    memset(c, 0, sizeof(struct topic_cursor_t) + 2 * state);
+    memcpy(c->node_name, node_name, strnlen(node_name, NODE_NAME_SIZE - 1));
+    c->ordinal        = ordinal;
+    c->local_state    = ra + sizeof(struct topic_cursor_t);
+    c->external_state = c->local_state + state;
+
+    c->next = __atomic_load_n(&topic->cursors, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&topic->cursors, &c->next, ra, true,
+        __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+    }
+    *found = FALSE;
+    return c;
+}
+
+static struct topic_registry_item_t*
+topic_partition_register(
+    struct topic_partition_t* par, struct topic_namespace_item_t* ns)
+{
+    ASSERT(par != NULL);
+    ASSERT(ns != NULL);
+
+    if (ns->length > par->limits.max_ring_elems)
+    {
+        WARN("topic [uuid=%lu] ring of %lu elements exceeds the partition "
+             "limit %lu.\n",
+            ns->uuid, ns->length, par->limits.max_ring_elems);
+        return NULL;
+    }
+    /* no ring yet, see topic_partition_local_ring() */
+    return topic_registry_insert(topic_partition_registry(par), ns->uuid,
+        ns->length, ns->elem_sz, INVALID_RELATIVE_ADDR, INVALID_RELATIVE_ADDR);
+}
+
+struct topic_registry_item_t*
+topic_partition_get(struct topic_partition_t* par, size_t uuid)
+{
+    ASSERT(par != NULL);
+
+    struct topic_registry_item_t* topic = NULL;
+    topic = topic_registry_query(topic_partition_registry(par), uuid);
+    if (topic != NULL)
+    {
+        return topic;
+    }
+    /* not found, create one */
+    struct topic_namespace_item_t* ns = topic_namespace_table_query_by_uuid(
+        topic_partition_namespace(par), uuid);
+    if (ns == NULL)
+    {
+        /* no such topic */
+        WARN("topic [uuid=%lu] does not define.\n", uuid);
+        return NULL;
+    }
+    topic = topic_partition_register(par, ns);
+    return topic;
+}
+
+/**
+ * the ring at `*ra`, allocated and installed with a CAS if there is none yet;
+ * the loser of a race releases its copy and takes the winner's.
+ */
+static struct topic_ring_t*
+topic_partition_install_ring(struct topic_partition_t* par,
+    struct topic_registry_item_t* topic, relative_addr_t* ra)
+{
+    relative_addr_t ring = __atomic_load_n(ra, __ATOMIC_ACQUIRE);
+    relative_addr_t expected = INVALID_RELATIVE_ADDR;
+
+    if (ring == INVALID_RELATIVE_ADDR)
+    {
+        ring = topic_partition_alloc(par,
+            sizeof(struct topic_ring_t)
+                + ((sizeof(struct topic_data_t) + topic->elem_sz)
+                    * topic->length)
+                + PADDING_BYTES);
+        if (ring == INVALID_RELATIVE_ADDR)
+        {
+            return NULL;
+        }
+        topic_ring_init((struct topic_ring_t*)topic_partition_get_addr(par, ring),
+            topic->length, topic->elem_sz);
+        if (!__atomic_compare_exchange_n(ra, &expected, ring, false,
+                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            topic_partition_free(par, ring);
+            ring = expected;
+        }
+    }
+    return (struct topic_ring_t*)topic_partition_get_addr(par, ring);
+}
+
+/**
+ * ring the publishers of the partition write to, allocated on first use.
+ * NULL if the topic buffer is exhausted.
+ */
+struct topic_ring_t*
+topic_partition_local_ring(
+    struct topic_partition_t* par, struct topic_registry_item_t* topic)
+{
+    return topic_partition_install_ring(par, topic, &topic->local_ring);
+}
+
+/**
+ * ring the master replicates the other partitions into, allocated when the
+ * topic is first subscribed. NULL if the topic buffer is exhausted.
+ */
+struct topic_ring_t*
+topic_partition_external_ring(
+    struct topic_partition_t* par, struct topic_registry_item_t* topic)
+{
+    return topic_partition_install_ring(par, topic, &topic->external_ring);
+}
+
+/**
+ * release the rings and the saved read positions of a topic, the rings are
+ * allocated again on the next use. publishers and subscribers of the topic
+ * in this partition must be gone. the master may still replicate from the
+ * rings, so they are only retired here and reused once thinros_master_update
+ * has unwired them (topic_partition_reclaim).
+ */
+bool
+topic_partition_remove(struct topic_partition_t* par, size_t uuid)
+{
+    ASSERT(par != NULL);
+
+    struct topic_registry_t*      reg   = topic_partition_registry(par);
+    struct topic_registry_item_t* topic = topic_registry_query(reg, uuid);
+    if (topic == NULL)
+    {
+        return FALSE;
+    }
+    topic_registry_wire(reg, topic, &topic->to_publish, FALSE);
+    topic_registry_wire(reg, topic, &topic->to_subscribe, FALSE);
+    topic_registry_wire(reg, topic, &topic->broadcast, FALSE);
+    __atomic_store_n(&topic->priority, PRIO_LOW, __ATOMIC_RELEASE);
+    /* unwired at this generation */
+    size_t generation = atomic_load(&reg->generation);
+    topic_partition_retire(par,
+        __atomic_exchange_n(
+            &topic->local_ring, INVALID_RELATIVE_ADDR, __ATOMIC_ACQ_REL),
+        generation);
+    topic_partition_retire(par,
+        __atomic_exchange_n(
+            &topic->external_ring, INVALID_RELATIVE_ADDR, __ATOMIC_ACQ_REL),
+        generation);
+
+    relative_addr_t ra = __atomic_exchange_n(
+        &topic->cursors, INVALID_RELATIVE_ADDR, __ATOMIC_ACQ_REL);
+    while (ra != INVALID_RELATIVE_ADDR)
+    {
+        relative_addr_t next
+            = ((struct topic_cursor_t*)topic_partition_get_addr(par, ra))->next;
+        topic_partition_retire(par, ra, generation);
+        ra = next;
+    }
+    return TRUE;
+}
+
+void
+topic_partition_usage(
+    struct topic_partition_t* par, struct topic_partition_usage_t* usage)
+{
+    struct topic_allocator_t* a   = &par->allocator;
+    struct topic_registry_t*  reg = topic_partition_registry(par);
+    size_t                    brk = atomic_load(&a->brk);
+    size_t                    i;
+
+    usage->size           = a->size;
+    usage->reserved       = a->base;
+    usage->in_use         = atomic_load(&a->in_use);
+    usage->released       = brk - a->base - usage->in_use;
+    usage->available      = a->size - brk;
+    usage->local_rings    = 0;
+    usage->external_rings = 0;
+    for (i = 0; i < reg->n; i++)
+    {
+        struct topic_registry_item_t* t = topic_registry_at(reg, i);
+        if (t != NULL)
+        {
+            usage->local_rings += t->local_ring != INVALID_RELATIVE_ADDR;
+            usage->external_rings += t->external_ring != INVALID_RELATIVE_ADDR;
+        }
+    }
+}
+
+struct topic_registry_item_t*
+topic_partition_get_by_name(
+    struct topic_partition_t* par, const char* topic_name)
+{
+    struct topic_namespace_item_t* ns = topic_namespace_table_query_by_name(
+        topic_partition_namespace(par), topic_name);
+    ASSERT(ns != NULL && "topic name not found!");
+    struct topic_registry_item_t* topic = topic_partition_get(par, ns->uuid);
+    ASSERT(topic != NULL && "cannot allocate topic ring locally!");
+
+    return topic;
+}
+
+static void
+thinros_timer_wheel_init(struct thinros_timer_wheel_t* w, uint64_t now)
+{
+    w->tick     = now >> TIMER_TICK_SHIFT;
+    w->n_timers = 0;
+    memset(w->slots, 0, sizeof(w->slots));
+}
+
+static void
+thinros_timer_link(struct thinros_timer_wheel_t* w, struct thinros_timer_t* t)
+{
+    uint64_t expires = t->expires >> TIMER_TICK_SHIFT;
+    uint64_t delta   = expires > w->tick ? expires - w->tick : 0;
+    size_t   level;
+
+    if (delta == 0)
+    {
+        /* already due, handled on the current tick */
+        expires = w->tick;
+    }
+    for (level = 0; level < TIMER_WHEEL_LEVELS - 1; level++)
+    {
+        if (delta < (1llu << ((level + 1) * TIMER_WHEEL_BITS)))
+        {
+            break;
+        }
+    }
+    if (delta >= (1llu << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS)))
+    {
+        /* beyond the wheel, park in the farthest slot and cascade again */
+        expires = w->tick
+                + (1llu << (TIMER_WHEEL_LEVELS * TIMER_WHEEL_BITS)) - 1;
+    }
+
+    size_t idx = (expires >> (level * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK;
+    struct thinros_timer_t** head = &w->slots[level][idx];
+    t->next                       = *head;
+    if (t->next != NULL)
+    {
+        t->next->pprev = &t->next;
+    }
+    t->pprev = head;
+    *head    = t;
+}
+
+static void
+thinros_timer_unlink(struct thinros_timer_t* t)
+{
+    *t->pprev = t->next;
+    if (t->next != NULL)
+    {
+        t->next->pprev = t->pprev;
+    }
+    t->next  = NULL;
+    t->pprev = NULL;
+}
+
+static void
+thinros_timer_cascade(struct thinros_timer_wheel_t* w, size_t level)
+{
+    size_t idx = (w->tick >> (level * TIMER_WHEEL_BITS)) & TIMER_WHEEL_MASK;
+    struct thinros_timer_t* t = w->slots[level][idx];
+
+    w->slots[level][idx] = NULL;
+    while (t != NULL)
+    {
+        struct thinros_timer_t* next = t->next;
+        thinros_timer_link(w, t);
+        t = next;
+    }
+    if (idx == 0 && level + 1 < TIMER_WHEEL_LEVELS)
+    {
+        thinros_timer_cascade(w, level + 1);
+    }
+}
+
+static void
+thinros_timer_add(struct thinros_timer_wheel_t* w, struct thinros_timer_t* t,
+    uint64_t expires, uint64_t period, thinros_callback_on_t callback,
+    void* arg)
+{
+    ASSERT(t != NULL);
+    ASSERT(callback != NULL);
+
+    t->wheel    = w;
+    t->expires  = expires;
+    t->period   = period;
+    t->overruns = 0;
+    t->callback = callback;
+    t->arg      = arg;
+    thinros_timer_link(w, t);
+    w->n_timers++;
+}
+
+void
+thinros_timer_periodic(_out struct thinros_timer_t* timer,
+    _in struct node_handle_t* n, _in uint64_t period,
+    _in thinros_callback_on_t callback, _in void* arg)
+{
+    ASSERT(n != NULL);
+    ASSERT(period != 0);
+    thinros_timer_add(
+        &n->timers, timer, thinros_now() + period, period, callback, arg);
+}
+
+void
+thinros_timer_oneshot(_out struct thinros_timer_t* timer,
+    _in struct node_handle_t* n, _in uint64_t delay,
+    _in thinros_callback_on_t callback, _in void* arg)
+{
+    ASSERT(n != NULL);
+    thinros_timer_add(
+        &n->timers, timer, thinros_now() + delay, 0, callback, arg);
+}
+
+void
+thinros_timer_cancel(_in struct thinros_timer_t* timer)
+{
+    ASSERT(timer != NULL);
+    if (timer->pprev == NULL)
+    {
+        /* expired one-shot or already cancelled */
+        return;
+    }
+    thinros_timer_unlink(timer);
+    timer->wheel->n_timers--;
+}
+
+/**
+ * fire every timer due at `now`, re-arming periodic ones. periods that are
+ * already over are skipped and counted as overruns.
+ *
+ * @return number of timers fired
+ */
+static size_t
+thinros_timer_advance(struct thinros_timer_wheel_t* w, uint64_t now)
+{
+    uint64_t target = now >> TIMER_TICK_SHIFT;
+    size_t   fired  = 0;
+
+    if (w->n_timers == 0)
+    {
+        w->tick = MAX(w->tick, target);
+        return 0;
+    }
+
+    for (;;)
+    {
+        struct thinros_timer_t** slot
+            = &w->slots[0][w->tick & TIMER_WHEEL_MASK];
+        struct thinros_timer_t** pt = slot;
+        while (*pt != NULL)
+        {
+            struct thinros_timer_t* t = *pt;
+            if (t->expires > now)
+            {
+                /* later in the current tick */
+                pt = &t->next;
+                continue;
+            }
+            thinros_timer_unlink(t);
+            if (t->period != 0)
+            {
+                t->expires += t->period;
+                if (t->expires <= now)
+                {
+                    size_t missed = (now - t->expires) / t->period + 1;
+                    t->overruns += missed;
+                    t->expires  += missed * t->period;
+                }
+                thinros_timer_link(w, t);
+            }
+            else
+            {
+                w->n_timers--;
+            }
+            t->callback(t->arg);
+            fired++;
+            /* the callback may have (re-)armed or cancelled timers */
+            pt = slot;
+        }
+
+        if (w->tick >= target)
+        {
+            break;
+        }
+        w->tick++;
+        if ((w->tick & TIMER_WHEEL_MASK) == 0)
+        {
+            thinros_timer_cascade(w, 1);
+        }
+    }
+    return fired;
+}
+
+/**
+ * earliest time the wheel needs attention: the first armed slot of level 0,
+ * or the next cascade of level 1 if that comes earlier.
+ *
+ * @return absolute time (ns), UINT64_MAX if no timer is armed
+ */
+static uint64_t
+thinros_timer_next(struct thinros_timer_wheel_t* w)
+{
+    uint64_t next = UINT64_MAX;
+    size_t   i, l;
+
+    if (w->n_timers == 0)
+    {
+        return next;
+    }
+    for (i = 0; i < TIMER_WHEEL_SLOTS; i++)
+    {
+        struct thinros_timer_t* t
+            = w->slots[0][(w->tick + i) & TIMER_WHEEL_MASK];
+        for (; t != NULL; t = t->next)
+        {
+            next = MIN(next, t->expires);
+        }
+        if (next != UINT64_MAX)
+        {
+            break;
+        }
+    }
+    for (l = 1; l < TIMER_WHEEL_LEVELS; l++)
+    {
+        for (i = 0; i < TIMER_WHEEL_SLOTS; i++)
+        {
+            if (w->slots[l][i] != NULL)
+            {
+                uint64_t cascade = ((w->tick | TIMER_WHEEL_MASK) + 1)
+                                << TIMER_TICK_SHIFT;
+                return MIN(next, cascade);
+            }
+        }
+    }
+    return next;
+}
+
+void
+thinros_node(struct node_handle_t* n, struct topic_partition_t* par,
+    const char* node_name)
+{
+    n->par       = par;
+    n->broadcast = NULL;
+    /* zero padded, the name identifies the node again after a restart */
+    memset(n->node_name, 0, NODE_NAME_SIZE);
+    memcpy(n->node_name, node_name, strnlen(node_name, NODE_NAME_SIZE - 1));
+    n->n_subscribers    = 0;
+    n->subscribers      = NULL;
+    n->subscribers_tail = &n->subscribers;
+    n->budget           = 0;
+    n->resume           = RESUME_AT_HEAD;
+    memset(n->stats, 0, sizeof(n->stats));
+    thinros_timer_wheel_init(&n->timers, thinros_now());
+    memset(&n->exec, 0, sizeof(n->exec));
+    n->exec_applied = false;
+}
+
+struct topic_ring_t *
+get_local_ring(struct topic_partition_t * par, struct topic_registry_item_t * topic)
+{
+    struct topic_ring_t * r;
+    r = (struct topic_ring_t *)topic_partition_get_addr(par, topic->local_ring);
+    ASSERT((void *) &par->topic_buffer <= (void *)r &&
+           (void *)r < (void *)&par->topic_buffer[TOPIC_BUFFER_SIZE]);
+    return (r);
+}
+
+struct topic_ring_t *
+get_external_ring(struct topic_partition_t * par, struct topic_registry_item_t * topic)
+{
+    struct topic_ring_t * r;
+    r = (struct topic_ring_t *)topic_partition_get_addr(par, topic->external_ring);
+    ASSERT((void *) &par->topic_buffer <= (void *)r &&
+           (void *)r < (void *)&par->topic_buffer[TOPIC_BUFFER_SIZE]);
+    return (r);
+}
+
+static void
+thinros_advertise_topic(struct publisher_t* publisher, struct node_handle_t* n,
+    struct topic_registry_item_t* topic)
+{
+    struct topic_ring_t* local = topic_partition_local_ring(n->par, topic);
+    ASSERT(local != NULL && "cannot allocate topic ring locally!");
+    topic_registry_wire(
+        topic_partition_registry(n->par), topic, &topic->to_publish, TRUE);
+    topic_writer_init(&publisher->writer, local);
+    publisher->topic_uuid = topic->uuid;
+    publisher->partition  = n->par;
+}
+
+void
+thinros_advertise(_out struct publisher_t* publisher,
+    _in _in struct node_handle_t* n, _in const char* topic_name)
+{
+    ASSERT(publisher != NULL);
+    ASSERT(n != NULL);
+    ASSERT(topic_name != NULL);
+
+    thinros_advertise_topic(
+        publisher, n, topic_partition_get_by_name(n->par, topic_name));
+}
+
+void
+thinros_advertise_uuid(_out struct publisher_t* publisher,
+    _in struct node_handle_t* n, _in size_t uuid)
+{
+    ASSERT(publisher != NULL);
+    ASSERT(n != NULL);
+
+    struct topic_registry_item_t* topic = topic_partition_get(n->par, uuid);
+    ASSERT(topic != NULL && "cannot allocate topic ring locally!");
+    thinros_advertise_topic(publisher, n, topic);
+}
+
+void
+thinros_publish(
+    _in struct publisher_t* publisher, _in void* message, _in size_t sz)
+{
+    ASSERT(publisher != NULL);
+    ASSERT(message != NULL);
+
+    topic_writer_write(&publisher->writer, message, sz);
+}
+
+static void
+node_handle_register_subscriber(struct node_handle_t* n, struct subscriber_t* s)
+{
+    s->next             = NULL;
+    *n->subscribers_tail = s;
+    n->subscribers_tail  = &s->next;
+    n->n_subscribers++;
+}
+
+void
+thinros_subscribe(_in struct subscriber_t* subscriber,
+    _in struct node_handle_t* n, _in const char* topic_name,
+    _in thinros_callback_on_t callback)
+{
+    thinros_subscribe_prio(
+        subscriber, n, topic_name, callback, PRIO_NORMAL, NO_DEADLINE);
+}
+
+/* save the read position in the partition, see thinros_node_resume() */
+static void
+thinros_subscriber_save(struct subscriber_t* s)
+{
+    s->cursor->local_head    = s->local_reader.read_head;
+    s->cursor->local_tail    = s->local_reader.read_tail;
+    s->cursor->external_head = s->external_reader.read_head;
+    s->cursor->external_tail = s->external_reader.read_tail;
+}
+
+/**
+ * position the readers of a subscription a restarted node had before
+ */
+static void
+thinros_subscriber_resume(
+    struct subscriber_t* subscriber, enum thinros_resume_t resume)
+{
+    struct topic_cursor_t* c  = subscriber->cursor;
+    struct topic_reader_t* lr = &subscriber->local_reader;
+    struct topic_reader_t* er = &subscriber->external_reader;
+
+    if (resume == RESUME_AT_SAVED)
+    {
+        lr->read_head = c->local_head;
+        lr->read_tail = c->local_tail;
+        er->read_head = c->external_head;
+        er->read_tail = c->external_tail;
+    }
+    else
+    {
+        lr->read_head = lr->read_tail = lr->ring->head;
+        if (er->ring != NULL)
+        {
+            er->read_head = er->read_tail = er->ring->head;
+        }
+        thinros_subscriber_save(subscriber);
+    }
+}
+
+/**
+ * read the broadcast ring of the subscription once the master has made it,
+ * which is after the subscription on its first one: thinros_spin_once tries
+ * again until then.
+ */
+static void
+thinros_subscriber_attach(struct node_handle_t* n, struct subscriber_t* s)
+{
+    struct topic_registry_item_t* topic = topic_registry_query(
+        topic_partition_registry(n->broadcast), s->topic_uuid);
+    relative_addr_t ring;
+
+    if (topic == NULL
+        || (ring = __atomic_load_n(&topic->local_ring, __ATOMIC_ACQUIRE))
+               == INVALID_RELATIVE_ADDR)
+    {
+        return;
+    }
+    s->external_reader.ring
+        = (struct topic_ring_t*)topic_partition_get_addr(n->broadcast, ring);
+}
+
+static void
+thinros_subscribe_topic(struct subscriber_t* subscriber,
+    struct node_handle_t* n, struct topic_registry_item_t* topic,
+    thinros_callback_on_t callback, enum thinros_priority_t priority,
+    uint64_t deadline)
+{
+    ASSERT(callback != NULL);
+    ASSERT(priority < MAX_PRIORITIES);
+
+    struct topic_ring_t * local, * external;
+    struct subscriber_t* s;
+    size_t ordinal = 0;
+    bool   reattach;
+
+    local    = topic_partition_local_ring(n->par, topic);
+    external = n->broadcast == NULL
+                 ? topic_partition_external_ring(n->par, topic)
+                 : NULL;
+    ASSERT(local != NULL && (external != NULL || n->broadcast != NULL)
+           && "cannot allocate topic ring locally!");
+    topic_registry_raise(topic_partition_registry(n->par), topic, priority);
+    if (n->broadcast != NULL)
+    {
+        topic_registry_wire(
+            topic_partition_registry(n->par), topic, &topic->broadcast, TRUE);
+    }
+    topic_registry_wire(
+        topic_partition_registry(n->par), topic, &topic->to_subscribe, TRUE);
+
+    for (s = n->subscribers; s != NULL; s = s->next)
+    {
+        ordinal += s->topic_uuid == topic->uuid;
+    }
+    subscriber->topic_uuid = topic->uuid;
+    subscriber->cursor     = topic_partition_cursor(
+        n->par, topic, n->node_name, ordinal, &reattach);
+    topic_reader_init(&subscriber->local_reader, local,
+        (enum topic_reader_data_status_t*)topic_partition_get_addr(
+            n->par, subscriber->cursor->local_state));
+    topic_reader_init(&subscriber->external_reader, external,
+        (enum topic_reader_data_status_t*)topic_partition_get_addr(
+            n->par, subscriber->cursor->external_state));
+    if (external == NULL)
+    {
+        thinros_subscriber_attach(n, subscriber);
+    }
+    if (reattach)
+    {
+        thinros_subscriber_resume(subscriber, n->resume);
+    }
+    subscriber->callback = callback;
+    subscriber->priority = priority;
+    subscriber->deadline = deadline;
+    subscriber->release  = 0;
+    thinros_histogram_reset(&subscriber->latency.delivery);
+    thinros_histogram_reset(&subscriber->latency.replication);
+    node_handle_register_subscriber(n, subscriber);
+}
+
+void
+thinros_subscribe_prio(_in struct subscriber_t* subscriber,
+    _in struct node_handle_t* n, _in const char* topic_name,
+    _in thinros_callback_on_t callback, _in enum thinros_priority_t priority,
+    _in uint64_t deadline)
+{
+    ASSERT(subscriber != NULL);
+    ASSERT(n != NULL);
+    ASSERT(topic_name != NULL);
+
+    thinros_subscribe_topic(subscriber, n,
+        topic_partition_get_by_name(n->par, topic_name), callback, priority,
+        deadline);
+}
+
+void
+thinros_subscribe_uuid(_in struct subscriber_t* subscriber,
+    _in struct node_handle_t* n, _in size_t uuid,
+    _in thinros_callback_on_t callback, _in enum thinros_priority_t priority,
+    _in uint64_t deadline)
+{
+    ASSERT(subscriber != NULL);
+    ASSERT(n != NULL);
+
+    struct topic_registry_item_t* topic = topic_partition_get(n->par, uuid);
+    ASSERT(topic != NULL && "cannot allocate topic ring locally!");
+    thinros_subscribe_topic(
+        subscriber, n, topic, callback, priority, deadline);
+}
+
+void
+thinros_node_budget(_in struct node_handle_t* n, _in uint64_t nanoseconds)
+{
+    ASSERT(n != NULL);
+    n->budget = nanoseconds;
+}
+
+/**
+ * receive the messages of the other partitions from the broadcast rings of
+ * `par` (see thinros_master_broadcast) instead of external rings of this
+ * partition: the master copies a message once for all the partitions
+ * subscribing to it. the node only reads `par`, which may be mapped
+ * read-only. for the subscriptions made afterwards; the master no longer
+ * copies their topics into the external rings of this partition, so the
+ * other nodes of the partition subscribing to them need it too.
+ */
+void
+thinros_node_broadcast(
+    _in struct node_handle_t* n, _in struct topic_partition_t* par)
+{
+    ASSERT(n != NULL);
+    n->broadcast = par;
+}
+
+/**
+ * where the subscriptions of a restarted node start reading. a node is known
+ * by its name: subscribing again to a topic it subscribed before it went down
+ * reuses the reader state kept in the partition, and starts at the current
+ * head of the rings (RESUME_AT_HEAD, the default) or after the last message
+ * it dispatched (RESUME_AT_SAVED). call before subscribing; node names must
+ * be unique in a partition.
+ */
+void
+thinros_node_resume(_in struct node_handle_t* n, _in enum thinros_resume_t resume)
+{
+    ASSERT(n != NULL);
+    n->resume = resume;
+}
+
+#if !defined(_STD_LIBC_)
+bool
+thinros_exec_apply_config(_in const struct thinros_exec_config_t* cfg,
+    _in struct topic_partition_t* par)
+{
+    /* nothing to configure, the secure world schedules the partition */
+    (void)cfg;
+    (void)par;
+    return true;
+}
+#endif
+
+bool
+thinros_exec_apply(_in struct node_handle_t* n)
+{
+    return thinros_exec_apply_config(&n->exec, n->par);
+}
+
+void
+thinros_node_exec(_in struct node_handle_t* n,
+    _in const struct thinros_exec_config_t* cfg)
+{
+    ASSERT(n != NULL);
+    ASSERT(cfg != NULL);
+    n->exec         = *cfg;
+    n->exec_applied = false;
+}
+
+static bool
+thinros_subscriber_pending(struct subscriber_t* s)
+{
+    return ((s->external_reader.ring != NULL
+                && s->external_reader.ring->head > s->external_reader.read_tail)
+            || s->local_reader.ring->head > s->local_reader.read_tail);
+}
+
+/**
+ * absolute deadline of a released subscriber; subscribers without a deadline
+ * sort after all others, in registration order
+ */
+static uint64_t
+thinros_subscriber_deadline(struct subscriber_t* s)
+{
+    return s->deadline == NO_DEADLINE ? UINT64_MAX : s->release + s->deadline;
+}
+
+/**
+ * pick the released subscriber of class `prio` with the earliest deadline
+ */
+static struct subscriber_t*
+thinros_spin_pick(struct node_handle_t* n, enum thinros_priority_t prio)
+{
+    struct subscriber_t* best = NULL;
+    struct subscriber_t* s;
+
+    for (s = n->subscribers; s != NULL; s = s->next)
+    {
+        if (s->priority != prio || s->release == 0)
+        {
+            continue;
+        }
+        if (best == NULL
+            || thinros_subscriber_deadline(s)
+                   < thinros_subscriber_deadline(best))
+        {
+            best = s;
+        }
+    }
+    return best;
+}
+
+static size_t
+thinros_spin_dispatch(struct node_handle_t* n, struct subscriber_t* s,
+    uint64_t now)
+{
+    struct thinros_dispatch_stats_t* st = &n->stats[s->priority];
+    uint64_t latency                    = now - s->release;
+
+    st->worst = MAX(st->worst, latency);
+    st->dispatched++;
+    s->release = 0;
+
+    size_t handled = 0;
+
+    if (s->external_reader.ring != NULL)
+    {
+        /* a broadcast ring also holds the copies of this partition's own */
+        handled += topic_reader_dispatch(&s->external_reader, n->buffer,
+            MAX_MESSAGE_SIZE, s->callback, &s->latency, n->par->partition_id);
+    }
+    handled += topic_reader_dispatch(&s->local_reader, n->buffer,
+        MAX_MESSAGE_SIZE, s->callback, &s->latency, (size_t)-1);
+
+    thinros_subscriber_save(s);
+    return handled;
+}
+
+/**
+ * service ready subscriptions by priority class, and by earliest deadline
+ * within a class. classes below PRIO_HIGH stop once the node budget is spent,
+ * the postponed subscriptions keep their release time for the next spin.
+ */
+static size_t
+thinros_spin_once(_in struct node_handle_t* n)
+{
+    ASSERT(n != NULL);
+    size_t   total_handled = 0;
+    size_t   released      = 0;
+    uint64_t start         = 0;
+    struct subscriber_t*    s;
+    enum thinros_priority_t prio;
+
+    if (n->timers.n_timers != 0)
+    {
+        start = thinros_now();
+        total_handled += thinros_timer_advance(&n->timers, start);
+    }
+
+    for (s = n->subscribers; s != NULL; s = s->next)
+    {
+        ASSERT(s->callback != NULL);
+        if (s->external_reader.ring == NULL)
+        {
+            thinros_subscriber_attach(n, s);
+        }
+        if (s->release == 0 && thinros_subscriber_pending(s))
+        {
+            if (start == 0)
+            {
+                start = thinros_now();
+            }
+            s->release = start;
+        }
+        released += s->release != 0;
+    }
+    if (released == 0)
+    {
+        return total_handled;
+    }
+    if (start == 0)
+    {
+        start = thinros_now();
+    }
+
+    for (prio = MAX_PRIORITIES; prio-- > 0;)
+    {
+        while ((s = thinros_spin_pick(n, prio)) != NULL)
+        {
+            uint64_t now = thinros_now();
+            if (prio < PRIO_HIGH && n->budget != 0 && now - start >= n->budget)
+            {
+                /* out of budget, leave the rest to the next spin */
+                struct subscriber_t* d;
+                for (d = n->subscribers; d != NULL; d = d->next)
+                {
+                    n->stats[d->priority].deferred
+                        += (d->priority <= prio && d->release != 0);
+                }
+                return total_handled;
+            }
+            total_handled += thinros_spin_dispatch(n, s, now);
+        }
+    }
+    return total_handled;
+}
+
+static void
+thinros_spin_forever(_in struct node_handle_t* n)
+{
+    while (atomic_load(&n->running) == true)
+    {
+        thinros_spin_once(n);
+    }
+}
+
+static void
+thinros_spin_yield(_in struct node_handle_t* n, void (*yield)(void))
+{
+    while (atomic_load(&n->running) == true)
+    {
+        thinros_spin_once(n);
+        yield();
+    }
+}
+
+static void
+thinros_spin_timeout(_in struct node_handle_t* n, uint64_t nanoseconds)
+{
+    unsigned long long start = thinros_now();
+    while (atomic_load(&n->running) == true)
+    {
+        thinros_spin_once(n);
+        if (thinros_now() - start > nanoseconds)
+        {
+            break;
+        }
+    }
+}
+
+static void
+thinros_spin_sleep(_in struct node_handle_t* n, void (*yield)(void),
+    uint64_t poll)
+{
+    while (atomic_load(&n->running) == true)
+    {
+        thinros_spin_once(n);
+        uint64_t wakeup = thinros_timer_next(&n->timers);
+        if (poll != 0)
+        {
+            wakeup = MIN(wakeup, thinros_now() + poll);
+        }
+        else if (wakeup == UINT64_MAX)
+        {
+            /* no timer left and no polling, nothing would wake us up */
+            break;
+        }
+#if defined(_STD_LIBC_)
+        (void)yield;
+        uint64_t now = thinros_now();
+        if (wakeup > now)
+        {
+            sleep_until_ns(time_ns() + (wakeup - now));
+        }
+#else
+        while (thinros_now() < wakeup)
+        {
+            if (yield != NULL)
+            {
+                yield();
+            }
+        }
+#endif
+    }
+}
+
+void
+thinros_spin(_in struct node_handle_t* n, enum thinros_spin_type_t type,
+    void (*yield)(void), uint64_t                                  nanoseconds)
+{
+    atomic_store(&n->running, true);
+
+    if (!n->exec_applied)
+    {
+        /* once per configuration, failures are reported by the platform */
+        thinros_exec_apply(n);
+        n->exec_applied = true;
+    }
+
+    switch (type)
+    {
+    case SPIN_ONCE: thinros_spin_once(n); break;
+    case SPIN_FOREVER: thinros_spin_forever(n); break;
+    case SPIN_YIELD: thinros_spin_yield(n, yield); break;
+    case SPIN_TIMEOUT: thinros_spin_timeout(n, nanoseconds); break;
+    case SPIN_SLEEP: thinros_spin_sleep(n, yield, nanoseconds); break;
+    default: PANIC("unknown spin type!");
+    }
+}
+
+static uintptr_t
+thinros_master_alloc(struct thinros_master_t* m, size_t sz)
+{
+    return m->arena.memory + linear_allocator_alloc(&m->arena, sz);
+}
+
+/* what a switch has spent of thinros_master_budget() */
+struct master_budget_t
+{
+    uint64_t start;
+    uint64_t deadline; /* start + budget_ns, 0: none */
+    size_t   bytes;
+};
+
+/*
+ * messages of `sz` bytes the switch may still copy below PRIO_HIGH. empty
+ * messages cost no payload, only the time budget bounds them.
+ */
+static size_t
+thinros_master_budget_left(
+    struct thinros_master_t* m, struct master_budget_t* budget, size_t sz)
+{
+    if (budget->deadline != 0 && thinros_now() >= budget->deadline)
+    {
+        return 0;
+    }
+    if (m->budget_bytes != 0 && sz != 0)
+    {
+        return m->budget_bytes > budget->bytes
+                 ? (m->budget_bytes - budget->bytes) / sz
+                 : 0;
+    }
+    return (size_t)-1;
+}
+
+/*
+ * count the messages of source `i` up to `head` left to the next switch,
+ * those already counted on an earlier switch only once
+ */
+static void
+topic_replicator_defer(struct topic_replicator_t* rep, size_t i, size_t head,
+    struct thinros_replication_stats_t* stats)
+{
+    struct topic_reader_t* rd   = &rep->sources[i];
+    size_t                 from = MAX(rep->counted[i], rd->read_tail);
+
+    if (head > from)
+    {
+        stats->deferred += MIN(head - from, rd->ring->n);
+        rep->counted[i] = head;
+    }
+}
+
+/**
+ * copy the new messages of every source. topics below PRIO_HIGH copy within
+ * the budget of the switch, what is left stays in the sources for the next.
+ *
+ * @return false if the budget ran out
+ */
+static bool
+topic_replicator_replicate(struct thinros_master_t* m,
+    struct topic_replicator_t* rep, struct master_budget_t* budget,
+    struct thinros_replication_stats_t* stats)
+{
+    size_t i, head, max, copied, sz;
+    bool   limited = rep->priority < PRIO_HIGH;
+    bool   out     = false;
+
+    for (i = 0; i < rep->n_sources; i++)
+    {
+        struct topic_reader_t* rd = &rep->sources[i];
+        head                      = atomic_load(&rd->ring->head);
+        if (rd->read_tail == head)
+        {
+            /* nothing published since the last copy, no sync */
+            stats->skipped++;
+            continue;
+        }
+        sz  = rep->destination.ring->elem_sz - sizeof(struct topic_data_t);
+        max = limited ? thinros_master_budget_left(m, budget, sz) : (size_t)-1;
+        if (out || max == 0)
+        {
+            out = true;
+            topic_replicator_defer(rep, i, head, stats);
+            continue;
+        }
+        stats->dropped += topic_reader_lost(rd);
+        copied = topic_ring_copy_max(rd, &rep->destination, max,
+            limited ? budget->deadline : 0, (uint32_t)rep->origins[i]);
+        stats->copied += copied;
+        budget->bytes += copied * sz;
+        head = atomic_load(&rd->ring->head);
+        if (limited && rd->read_tail != head
+            && thinros_master_budget_left(m, budget, sz) == 0)
+        {
+            /* cut short, the rest of the source waits */
+            out = true;
+            topic_replicator_defer(rep, i, head, stats);
+        }
+    }
+    return !out;
+}
+
+/* the replicator of registry item `idx`, made on its first subscription */
+static struct topic_replicator_t*
+thinros_master_replicator(struct thinros_master_t* m,
+    struct master_record_t* r, size_t idx, struct topic_registry_item_t* topic)
 {
-    n->par = par;
-    size_t len = strnlen(node_name, NODE_NAME_SIZE);
-    memcpy(n->node_name, node_name, MIN(len, NODE_NAME_SIZE));
-    n->n_subscribers = 0;
+    struct topic_replicator_t* rep = r->by_item[idx];
+    if (rep != NULL)
+    {
+        return rep;
+    }
+    rep = (struct topic_replicator_t*)thinros_master_alloc(
+        m, sizeof(struct topic_replicator_t));
+    rep->topic_uuid = topic->uuid;
+    rep->length     = topic->length;
+    rep->readers    = 0;
+    rep->n_sources  = 0;
+    rep->sources    = (struct topic_reader_t*)thinros_master_alloc(
+        m, m->max_partitions * sizeof(struct topic_reader_t));
+    rep->origins = (size_t*)thinros_master_alloc(
+        m, m->max_partitions * sizeof(size_t));
+    rep->counted = (size_t*)thinros_master_alloc(
+        m, m->max_partitions * sizeof(size_t));
+    memset(rep->sources, 0, m->max_partitions * sizeof(struct topic_reader_t));
+    r->by_item[idx] = rep;
+    return rep;
 }
 
-struct topic_ring_t *
-get_local_ring(struct topic_partition_t * par, struct topic_registry_item_t * topic)
+/* read `local_ring` of partition `origin` from its start */
+static void
+topic_replicator_connect(struct thinros_master_t* m,
+    struct topic_replicator_t* rep, size_t origin,
+    struct topic_ring_t* local_ring)
 {
-    struct topic_ring_t * r;
-    r = (struct topic_ring_t *)topic_partition_get_addr(par, topic->local_ring);
-    ASSERT((void *) &par->topic_buffer <= (void *)r &&
-           (void *)r < (void *)&par->topic_buffer[TOPIC_BUFFER_SIZE]);
-    return (r);
+    struct topic_reader_t*           rd = &rep->sources[rep->n_sources];
+    enum topic_reader_data_status_t* read_ring = rd->read_ring;
+
+    if (read_ring == NULL || local_ring->n > rep->length)
+    {
+        /* the reader state of a source dropped earlier is reused */
+        read_ring = (enum topic_reader_data_status_t*)thinros_master_alloc(m,
+            MAX(local_ring->n, rep->length)
+                * sizeof(enum topic_reader_data_status_t));
+    }
+    topic_reader_init(rd, local_ring, read_ring);
+    rep->counted[rep->n_sources]   = 0;
+    rep->origins[rep->n_sources++] = origin;
 }
 
-struct topic_ring_t *
-get_external_ring(struct topic_partition_t * par, struct topic_registry_item_t * topic)
+static void
+topic_replicator_disconnect(struct topic_replicator_t* rep, size_t origin)
 {
-    struct topic_ring_t * r;
-    r = (struct topic_ring_t *)topic_partition_get_addr(par, topic->external_ring);
-    ASSERT((void *) &par->topic_buffer <= (void *)r &&
-           (void *)r < (void *)&par->topic_buffer[TOPIC_BUFFER_SIZE]);
-    return (r);
+    size_t i;
+    for (i = 0; i < rep->n_sources; i++)
+    {
+        if (rep->origins[i] == origin)
+        {
+            /* swap, the dropped reader state stays past the connected ones */
+            struct topic_reader_t rd = rep->sources[i];
+            rep->n_sources--;
+            rep->sources[i]              = rep->sources[rep->n_sources];
+            rep->origins[i]              = rep->origins[rep->n_sources];
+            rep->counted[i]              = rep->counted[rep->n_sources];
+            rep->sources[rep->n_sources] = rd;
+            return;
+        }
+    }
 }
 
-void
-thinros_advertise(_out struct publisher_t* publisher,
-    _in _in struct node_handle_t* n, _in char* topic_name)
+/* the wiring of `uuid` in partition `idx`, NULL if it has none yet */
+static struct master_wiring_t*
+thinros_master_wiring(struct thinros_master_t* m, size_t idx, size_t uuid,
+    size_t* item)
 {
-    ASSERT(publisher != NULL);
-    ASSERT(n != NULL);
-    ASSERT(topic_name != NULL);
+    struct master_record_t*       r = &m->partitions[idx];
+    struct topic_registry_t*      reg;
+    struct topic_registry_item_t* topic;
 
-    struct topic_registry_item_t* topic
-        = topic_partition_get_by_name(n->par, topic_name);
-    topic->to_publish          = TRUE;
-    struct topic_ring_t* local = get_local_ring(n->par, topic);
-    topic_writer_init(&publisher->writer, local);
-    publisher->topic_uuid = topic_namespace_query_by_name(topic_name)->uuid;
-    publisher->partition  = n->par;
+    if (r->wiring == NULL)
+    {
+        return NULL;
+    }
+    reg   = topic_partition_registry(r->address);
+    topic = topic_registry_query(reg, uuid);
+    if (topic == NULL)
+    {
+        return NULL;
+    }
+    *item = (size_t)(topic - reg->topic);
+    return &r->wiring[*item];
 }
 
-void
-thinros_publish(
-    _in struct publisher_t* publisher, _in void* message, _in size_t sz)
+/* the replicator of the broadcast ring of `uuid`, NULL if none is read */
+static struct topic_replicator_t*
+thinros_master_broadcast_replicator(struct thinros_master_t* m, size_t uuid)
 {
-    ASSERT(publisher != NULL);
-    ASSERT(message != NULL);
+    struct topic_registry_t*      reg;
+    struct topic_registry_item_t* topic;
+    struct topic_replicator_t*    rep;
 
-    topic_writer_write(&publisher->writer, message, sz);
+    if (m->broadcast.wiring == NULL)
+    {
+        return NULL;
+    }
+    reg   = topic_partition_registry(m->broadcast.address);
+    topic = topic_registry_query(reg, uuid);
+    if (topic == NULL)
+    {
+        return NULL;
+    }
+    rep = m->broadcast.by_item[topic - reg->topic];
+    return rep != NULL && rep->readers > 0 ? rep : NULL;
 }
 
+/* connect or drop the local ring of `uuid` in partition `origin` */
 static void
-node_handle_register_subscriber(struct node_handle_t* n, struct subscriber_t* s)
-{
-    size_t idx = atomic_fetch_add(&n->n_subscribers, 1);
-    ASSERT(idx < MAX_TOPICS_SUBSCRIBE);
-    n->subscribers[idx] = s;
-}
-
-void
-thinros_subscribe(_in struct subscriber_t* subscriber,
-    _in struct node_handle_t* n, _in char* topic_name,
-    _in thinros_callback_on_t callback)
+thinros_master_wire_publisher(struct thinros_master_t* m, size_t origin,
+    size_t uuid, relative_addr_t local_ring)
 {
-    ASSERT(subscriber != NULL);
-    ASSERT(n != NULL);
-    ASSERT(topic_name != NULL);
-    ASSERT(callback != NULL);
-
-    struct topic_registry_item_t* topic
-        = topic_partition_get_by_name(n->par, topic_name);
-    topic->to_subscribe = TRUE;
+    struct topic_replicator_t* rep;
+    struct master_wiring_t*    w;
+    size_t                     i, item;
 
-    struct topic_ring_t * local, * external;
-    local    = get_local_ring(n->par, topic);
-    external = get_external_ring(n->par, topic);
-    topic_reader_init(&subscriber->local_reader, local);
-    topic_reader_init(&subscriber->external_reader, external);
-    subscriber->callback = callback;
-    node_handle_register_subscriber(n, subscriber);
-    subscriber->topic_uuid = topic_namespace_query_by_name(topic_name)->uuid;
+    for (i = 0; i < m->n_partitions; i++)
+    {
+        if (i == origin
+            || (w = thinros_master_wiring(m, i, uuid, &item)) == NULL
+            || w->subscribed == INVALID_RELATIVE_ADDR)
+        {
+            continue;
+        }
+        rep = m->partitions[i].by_item[item];
+        topic_replicator_disconnect(rep, origin);
+        if (local_ring != INVALID_RELATIVE_ADDR)
+        {
+            topic_replicator_connect(m, rep, origin,
+                (struct topic_ring_t*)topic_partition_get_addr(
+                    m->partitions[origin].address, local_ring));
+        }
+    }
+    if ((rep = thinros_master_broadcast_replicator(m, uuid)) != NULL)
+    {
+        topic_replicator_disconnect(rep, origin);
+        if (local_ring != INVALID_RELATIVE_ADDR)
+        {
+            topic_replicator_connect(m, rep, origin,
+                (struct topic_ring_t*)topic_partition_get_addr(
+                    m->partitions[origin].address, local_ring));
+        }
+    }
 }
 
-static size_t
-thinros_spin_once(_in struct node_handle_t* n)
+/* run `rep` on the switches, after the replicators of its priority */
+static void
+thinros_master_activate(
+    struct master_record_t* r, struct topic_replicator_t* rep)
 {
-    ASSERT(n != NULL);
-    size_t total_handled = 0;
     size_t i;
-
-    for (i = 0; i < n->n_subscribers; i++)
+    for (i = r->n_replicators++;
+         i > 0 && r->replicators[i - 1]->priority < rep->priority; i--)
     {
-        struct subscriber_t* s = n->subscribers[i];
-        ASSERT(s != NULL);
-        ASSERT(s->callback != NULL);
-        total_handled += topic_reader_read_all(
-            &s->external_reader, n->buffer, MAX_MESSAGE_SIZE, s->callback);
-        total_handled += topic_reader_read_all(
-            &s->local_reader, n->buffer, MAX_MESSAGE_SIZE, s->callback);
+        r->replicators[i]       = r->replicators[i - 1];
+        r->replicators[i]->slot = i;
     }
-    return total_handled;
+    r->replicators[i] = rep;
+    rep->slot         = i;
 }
 
 static void
-thinros_spin_forever(_in struct node_handle_t* n)
+thinros_master_deactivate(
+    struct master_record_t* r, struct topic_replicator_t* rep)
 {
-    while (atomic_load(&n->running) == true)
+    size_t i;
+    r->n_replicators--;
+    for (i = rep->slot; i < r->n_replicators; i++)
     {
-        thinros_spin_once(n);
+        r->replicators[i]       = r->replicators[i + 1];
+        r->replicators[i]->slot = i;
     }
 }
 
+/* move `rep` to its place for `priority` among the active replicators */
 static void
-thinros_spin_yield(_in struct node_handle_t* n, void (*yield)(void))
+thinros_master_prioritize(struct master_record_t* r,
+    struct topic_replicator_t* rep, uint32_t priority)
 {
-    while (atomic_load(&n->running) == true)
-    {
-        thinros_spin_once(n);
-        yield();
-    }
+    thinros_master_deactivate(r, rep);
+    rep->priority = priority;
+    thinros_master_activate(r, rep);
 }
 
+/* (de)activate the replicator of registry item `idx` of partition `dest` */
 static void
-thinros_spin_timeout(_in struct node_handle_t* n, uint64_t nanoseconds)
+thinros_master_wire_subscriber(struct thinros_master_t* m, size_t dest,
+    size_t idx, struct topic_registry_item_t* topic,
+    relative_addr_t external_ring)
 {
-    unsigned long long start = time_ns();
-    while (atomic_load(&n->running) == true)
+    struct master_record_t*    r   = &m->partitions[dest];
+    struct topic_replicator_t* rep = thinros_master_replicator(m, r, idx, topic);
+    struct master_wiring_t*    w;
+    size_t                     i, item;
+
+    if (r->wiring[idx].subscribed != INVALID_RELATIVE_ADDR)
     {
-        thinros_spin_once(n);
-        if (time_ns() - start > nanoseconds)
+        thinros_master_deactivate(r, rep);
+        while (rep->n_sources > 0)
         {
-            break;
+            topic_replicator_disconnect(rep, rep->origins[0]);
         }
     }
+    if (external_ring == INVALID_RELATIVE_ADDR)
+    {
+        return;
+    }
+    topic_writer_init(&rep->destination,
+        (struct topic_ring_t*)topic_partition_get_addr(
+            r->address, external_ring));
+    for (i = 0; i < m->n_partitions; i++)
+    {
+        if (i != dest
+            && (w = thinros_master_wiring(m, i, rep->topic_uuid, &item)) != NULL
+            && w->published != INVALID_RELATIVE_ADDR)
+        {
+            topic_replicator_connect(m, rep, i,
+                (struct topic_ring_t*)topic_partition_get_addr(
+                    m->partitions[i].address, w->published));
+        }
+    }
+    rep->priority = __atomic_load_n(&topic->priority, __ATOMIC_ACQUIRE);
+    thinros_master_activate(r, rep);
 }
 
-void
-thinros_spin(_in struct node_handle_t* n, enum thinros_spin_type_t type,
-    void (*yield)(void), uint64_t                                  nanoseconds)
+/**
+ * count a partition in or out of the readers of the broadcast ring of
+ * `topic`. the first reader has the ring made in the broadcast partition and
+ * the publishers of all the partitions connected, the origin's included; the
+ * last one stops the replication. the ring stays for a later reader. the
+ * priority is the highest of the readers so far.
+ *
+ * @return false if there is no room for the ring in the broadcast partition
+ */
+static bool
+thinros_master_wire_broadcast(struct thinros_master_t* m,
+    struct topic_registry_item_t* topic, bool subscribed, uint32_t priority)
 {
-    atomic_store(&n->running, true);
+    struct master_record_t*       r    = &m->broadcast;
+    struct topic_registry_t*      reg  = topic_partition_registry(r->address);
+    struct topic_registry_item_t* item = topic_registry_query(reg, topic->uuid);
+    struct topic_replicator_t*    rep;
+    struct topic_ring_t*          ring = NULL;
+    struct master_wiring_t*       w;
+    size_t                        i, j;
+
+    if (item == NULL)
+    {
+        item = topic_registry_insert(reg, topic->uuid, topic->length,
+            topic->elem_sz, INVALID_RELATIVE_ADDR, INVALID_RELATIVE_ADDR);
+    }
+    if (item != NULL)
+    {
+        ring = topic_partition_local_ring(r->address, item);
+    }
+    if (ring == NULL)
+    {
+        WARN("no broadcast ring for topic [uuid=%lu].\n", topic->uuid);
+        return FALSE;
+    }
+    rep = thinros_master_replicator(m, r, (size_t)(item - reg->topic), item);
 
-    switch (type)
+    if (!subscribed)
     {
-    case SPIN_ONCE: thinros_spin_once(n); break;
-    case SPIN_FOREVER: thinros_spin_forever(n); break;
-    case SPIN_YIELD: thinros_spin_yield(n, yield); break;
-    case SPIN_TIMEOUT: thinros_spin_timeout(n, nanoseconds); break;
-    default: PANIC("unknown spin type!");
+        if (--rep->readers == 0)
+        {
+            thinros_master_deactivate(r, rep);
+            while (rep->n_sources > 0)
+            {
+                topic_replicator_disconnect(rep, rep->origins[0]);
+            }
+        }
+        return TRUE;
+    }
+    if (rep->readers++ > 0)
+    {
+        if (priority > rep->priority)
+        {
+            thinros_master_prioritize(r, rep, priority);
+        }
+        return TRUE;
+    }
+    topic_writer_init(&rep->destination, ring);
+    for (i = 0; i < m->n_partitions; i++)
+    {
+        if ((w = thinros_master_wiring(m, i, rep->topic_uuid, &j)) != NULL
+            && w->published != INVALID_RELATIVE_ADDR)
+        {
+            topic_replicator_connect(m, rep, i,
+                (struct topic_ring_t*)topic_partition_get_addr(
+                    m->partitions[i].address, w->published));
+        }
     }
+    rep->priority = priority;
+    thinros_master_activate(r, rep);
+    return TRUE;
 }
 
-static void
-topic_replicator_init(struct topic_replicator_t* rep, size_t uuid,
-    struct topic_ring_t* external_ring)
+/* a reader of a broadcast ring raised its priority above the others' */
+static bool
+thinros_master_broadcast_raise(
+    struct thinros_master_t* m, size_t uuid, uint32_t priority)
 {
-    ASSERT(rep != NULL);
-    ASSERT(external_ring != NULL);
+    struct topic_replicator_t* rep;
 
-    rep->topic_uuid = uuid;
-    rep->n_sources  = 0;
-    topic_writer_init(&rep->destination, external_ring);
+    rep = thinros_master_broadcast_replicator(m, uuid);
+    if (rep == NULL || rep->priority >= priority)
+    {
+        return FALSE;
+    }
+    thinros_master_prioritize(&m->broadcast, rep, priority);
+    return TRUE;
 }
 
+/* per registry item tables of a partition, on its first update */
 static void
-topic_replicator_connect(
-    struct topic_replicator_t* rep, struct topic_ring_t* local_ring)
+thinros_master_tables(struct thinros_master_t* m, struct master_record_t* r)
 {
-    size_t idx = atomic_fetch_add(&rep->n_sources, 1);
-    ASSERT(idx < MAX_PARTITIONS);
-    struct topic_reader_t* rd = &rep->sources[idx];
-    topic_reader_init(rd, local_ring);
+    size_t max = topic_partition_registry(r->address)->max_topics, i;
+
+    r->n_replicators = 0;
+    r->replicators   = (struct topic_replicator_t**)thinros_master_alloc(
+        m, max * sizeof(struct topic_replicator_t*));
+    r->by_item = (struct topic_replicator_t**)thinros_master_alloc(
+        m, max * sizeof(struct topic_replicator_t*));
+    r->wiring = (struct master_wiring_t*)thinros_master_alloc(
+        m, max * sizeof(struct master_wiring_t));
+    for (i = 0; i < max; i++)
+    {
+        r->by_item[i]           = NULL;
+        r->wiring[i].published  = INVALID_RELATIVE_ADDR;
+        r->wiring[i].subscribed = INVALID_RELATIVE_ADDR;
+        r->wiring[i].broadcast  = FALSE;
+    }
 }
 
 static void
-topic_replicator_replicate(struct topic_replicator_t* rep)
+master_record_init(struct master_record_t* r, struct topic_partition_t* par)
 {
-    size_t i;
-    for (i = 0; i < rep->n_sources; i++)
-    {
-        struct topic_reader_t* rd = &rep->sources[i];
-        topic_ring_copy(rd, &rep->destination);
-    }
+    r->address       = par;
+    r->replicators   = NULL;
+    r->n_replicators = 0;
+    r->by_item       = NULL;
+    r->wiring        = NULL;
+    r->generation    = 0;
+    r->resume        = NULL;
+    thinros_histogram_reset(&r->stats.time);
+    r->stats.copied   = 0;
+    r->stats.skipped  = 0;
+    r->stats.deferred = 0;
+    r->stats.dropped  = 0;
 }
 
+/**
+ * @param max_partitions number of partitions the master can manage
+ * @param arena secure memory for the master tables, 8-byte aligned
+ */
 void
-thinros_master_init(struct thinros_master_t* m)
+thinros_master_init(struct thinros_master_t* m, size_t max_partitions,
+    void* arena, size_t arena_sz)
 {
-    m->n_partitions = 0;
+    ASSERT(arena != NULL);
+    ASSERT(((uintptr_t)arena) % 8 == 0);
+
+    m->n_partitions   = 0;
+    m->max_partitions = max_partitions;
+    m->budget_bytes   = 0;
+    m->budget_ns      = 0;
+    linear_allocator_init(&m->arena, arena_sz);
+    m->arena.memory = (uintptr_t)arena;
+    m->partitions   = (struct master_record_t*)thinros_master_alloc(
+        m, max_partitions * sizeof(struct master_record_t));
+    m->tables = m->arena.brk;
+    master_record_init(&m->broadcast, NULL);
 }
 
+/**
+ * manage `par`. the master adopts the clock calibration of the first
+ * partition and stamps the others with it, so that the publish stamps of
+ * every partition and the replication stamps compare; processes attaching
+ * to a partition after it was added share it too.
+ */
 void
 thinros_master_add(struct thinros_master_t* m, struct topic_partition_t* par)
 {
     size_t idx = atomic_fetch_add(&m->n_partitions, 1);
-    ASSERT(idx < MAX_PARTITIONS);
-    par->partition_id         = idx;
-    struct master_record_t* r = &m->partitions[idx];
-    r->address                = par;
-    r->n_replicators          = 0;
+    ASSERT(idx < m->max_partitions && "too many partitions!");
+    par->partition_id = idx;
+    master_record_init(&m->partitions[idx], par);
+    if (idx == 0)
+    {
+        thinros_clock_adopt(&par->clock);
+    }
+    thinros_clock_publish(&par->clock);
 }
 
-static void
-thinros_master_connect_topics_per_partition(
-    struct topic_replicator_t* rep, struct topic_partition_t* par)
+/**
+ * replicate the topics that nodes subscribe to with thinros_node_broadcast()
+ * through `par`, a partition of its own that no node publishes in: the
+ * master copies a message once into the broadcast ring of its topic, made in
+ * `par` on the first subscription, and every subscribing partition reads it
+ * there, mapped read-only, rather than the master copying it into an
+ * external ring of each. the broadcast rings are fed on every switch, ahead
+ * of the replicators of the partition switched to and within its budget. a
+ * reader passes over the copies of its own partition's messages, which it
+ * reads from the local ring. call before thinros_master_build.
+ */
+void
+thinros_master_broadcast(
+    struct thinros_master_t* m, struct topic_partition_t* par)
+{
+    ASSERT(par != NULL);
+    par->partition_id = m->max_partitions;
+    master_record_init(&m->broadcast, par);
+    thinros_clock_publish(&par->clock);
+}
+
+/**
+ * bound the replication of a switch: topics below PRIO_HIGH stop copying
+ * once `bytes` of payload or `nanoseconds` are spent (0: no bound), the rest
+ * is deferred to the next switch to the partition, resuming with the topic
+ * the budget ran out on. topics of PRIO_HIGH and above are always copied.
+ * the priority of a topic is the highest of its subscribers in the partition.
+ * the broadcast rings have a budget of the same size on every switch, so
+ * they neither eat into the partition's nor starve among themselves.
+ */
+void
+thinros_master_budget(
+    struct thinros_master_t* m, size_t bytes, uint64_t nanoseconds)
+{
+    m->budget_bytes = bytes;
+    m->budget_ns    = nanoseconds;
+}
+
+/**
+ * restart the replication statistics of partition `idx`, of the broadcast
+ * rings for `idx` n_partitions or above
+ */
+void
+thinros_master_stats_reset(struct thinros_master_t* m, size_t idx)
+{
+    struct thinros_replication_stats_t* stats = idx < m->n_partitions
+                                                  ? &m->partitions[idx].stats
+                                                  : &m->broadcast.stats;
+    thinros_histogram_reset(&stats->time);
+    stats->copied   = 0;
+    stats->skipped  = 0;
+    stats->deferred = 0;
+    stats->dropped  = 0;
+}
+
+/**
+ * drop all the tables and wire every partition from scratch, the sources
+ * read their rings from the start again
+ */
+void
+thinros_master_build(struct thinros_master_t* m)
 {
     size_t i;
-    struct topic_registry_t * topics = &par->registry;
-    for (i = 0; i < topics->n; i++)
+
+    /* drop the tables of the previous build */
+    atomic_store(&m->arena.brk, m->tables);
+    for (i = 0; i < m->n_partitions; i++)
+    {
+        m->partitions[i].wiring = NULL;
+    }
+    m->broadcast.wiring = NULL;
+    thinros_master_update(m);
+}
+
+/* wire registry item `j` of partition `i` as it is now, the wiring changes */
+static size_t
+thinros_master_wire_item(struct thinros_master_t* m, size_t i, size_t j)
+{
+    struct master_record_t*       r     = &m->partitions[i];
+    struct topic_registry_item_t* topic
+        = topic_registry_at(topic_partition_registry(r->address), j);
+    struct master_wiring_t* w          = &r->wiring[j];
+    relative_addr_t         published  = INVALID_RELATIVE_ADDR;
+    relative_addr_t         subscribed = INVALID_RELATIVE_ADDR;
+    uint32_t                priority   = PRIO_LOW;
+    bool                    broadcast  = FALSE;
+    size_t                  changes    = 0;
+
+    if (topic == NULL)
+    {
+        return 0;
+    }
+    if (__atomic_load_n(&topic->to_publish, __ATOMIC_ACQUIRE))
+    {
+        published = topic->local_ring;
+    }
+    if (__atomic_load_n(&topic->to_subscribe, __ATOMIC_ACQUIRE))
+    {
+        priority = __atomic_load_n(&topic->priority, __ATOMIC_ACQUIRE);
+        broadcast = m->broadcast.address != NULL
+                 && __atomic_load_n(&topic->broadcast, __ATOMIC_ACQUIRE);
+        /* the broadcast ring replaces the external ring */
+        subscribed = broadcast ? INVALID_RELATIVE_ADDR : topic->external_ring;
+    }
+    if (published != w->published)
+    {
+        /* also a ring allocated again after a removal */
+        w->published = published;
+        thinros_master_wire_publisher(m, i, topic->uuid, published);
+        changes++;
+    }
+    if (subscribed != w->subscribed)
+    {
+        thinros_master_wire_subscriber(m, i, j, topic, subscribed);
+        w->subscribed = subscribed;
+        changes++;
+    }
+    else if (subscribed != INVALID_RELATIVE_ADDR
+             && r->by_item[j]->priority != priority)
+    {
+        /* a subscriber of a higher priority came, move it up */
+        thinros_master_prioritize(r, r->by_item[j], priority);
+        changes++;
+    }
+    if (broadcast != w->broadcast)
     {
-        struct topic_registry_item_t * topic = &topics->topic[i];
-        if (topic->uuid == rep->topic_uuid && topic->to_publish == TRUE)
+        if (thinros_master_wire_broadcast(m, topic, broadcast, priority))
         {
-            struct topic_ring_t * local = get_local_ring(par, topic);
-            topic_replicator_connect(rep, local);
+            w->broadcast = broadcast;
+            changes++;
         }
     }
+    else if (broadcast
+             && thinros_master_broadcast_raise(m, topic->uuid, priority))
+    {
+        changes++;
+    }
+    return changes;
 }
 
-static void
-thinros_master_connect_topics(struct topic_replicator_t* rep,
-    size_t current_partition_idx, struct thinros_master_t* m)
+/*
+ * the items changed in `reg` from generation `*from` to `to` by its log,
+ * wired one by one. false if the log was overwritten meanwhile, the items
+ * have to be walked. `*from` stops at a change still being logged.
+ */
+static bool
+thinros_master_wire_log(struct thinros_master_t* m, size_t i,
+    struct topic_registry_t* reg, size_t* from, size_t to, size_t* changes)
 {
-    size_t i;
-    for (i = 0; i < m->n_partitions; i++)
+    size_t g;
+
+    if (to - *from > TOPIC_REGISTRY_LOG)
     {
-        if (i == current_partition_idx)
+        return false;
+    }
+    for (g = *from; g < to; g++)
+    {
+        uint64_t e = atomic_load(&reg->log[g & (TOPIC_REGISTRY_LOG - 1)]);
+        int32_t  d = (int32_t)((uint32_t)(e >> 32) - (uint32_t)g);
+        if (d > 0)
         {
-            continue;
+            return false;
         }
-        thinros_master_connect_topics_per_partition(
-            rep, m->partitions[i].address);
+        if (d < 0)
+        {
+            /* bumped, not logged yet: from there on at the next update */
+            break;
+        }
+        *changes += thinros_master_wire_item(m, i, (uint32_t)e);
     }
+    *from = g;
+    return true;
 }
 
-void
-thinros_master_build(struct thinros_master_t* m)
+/**
+ * wire the topics that gained or lost their publishers or subscribers since
+ * the last update or build: only the registry items changed since, found in
+ * the registry's log, are visited, and only the replicators of the changed
+ * topics touched, the others keep replicating from where they are. the
+ * first update of a partition, and one that fell behind its log, walk all
+ * items. must not run concurrently with thinros_master_switch_to(). topics
+ * removed with topic_partition_remove() are unwired here and their memory
+ * released afterwards.
+ *
+ * @return number of wiring changes
+ */
+size_t
+thinros_master_update(struct thinros_master_t* m)
 {
-    size_t i;
+    size_t i, j, n, changes = 0;
+
+    if (m->broadcast.address != NULL && m->broadcast.wiring == NULL)
+    {
+        thinros_master_tables(m, &m->broadcast);
+    }
     for (i = 0; i < m->n_partitions; i++)
     {
-        size_t j;
+        struct master_record_t*  r   = &m->partitions[i];
+        struct topic_registry_t* reg = topic_partition_registry(r->address);
+        /* read first, a change while wiring shows at the next update */
+        size_t generation = atomic_load(&reg->generation);
+
+        if (r->wiring == NULL)
+        {
+            thinros_master_tables(m, r);
+        }
+        else if (thinros_master_wire_log(
+                     m, i, reg, &r->generation, generation, &changes))
+        {
+            /* nothing up to it is wired to a removed ring anymore */
+            topic_partition_reclaim(r->address, r->generation);
+            continue;
+        }
+        r->generation = generation;
+        n             = atomic_load(&reg->n);
+        for (j = 0; j < n; j++)
+        {
+            changes += thinros_master_wire_item(m, i, j);
+        }
+        topic_partition_reclaim(r->address, generation);
+    }
+    return changes;
+}
+
+/*
+ * run the replicators of `r` on a switch, within a budget of its own: by
+ * priority class, each class from where the budget ran out in it last
+ */
+static void
+thinros_master_replicate(struct thinros_master_t* m, struct master_record_t* r)
+{
+    struct master_budget_t budget = { .start = thinros_now(), .bytes = 0 };
+    size_t                 lo, hi = 0, first, i, k;
+    bool                   out    = false;
 
-        struct master_record_t* par = &m->partitions[i];
-        par->n_replicators          = 0;
-        for (j = 0; j < par->address->registry.n; j++)
+    budget.deadline = m->budget_ns != 0 ? budget.start + m->budget_ns : 0;
+    if (m->budget_bytes == 0 && m->budget_ns == 0)
+    {
+        /* no budget, in priority order */
+        for (i = 0; i < r->n_replicators; i++)
+        {
+            topic_replicator_replicate(
+                m, r->replicators[i], &budget, &r->stats);
+        }
+        hi = r->n_replicators;
+    }
+    for (lo = hi; lo < r->n_replicators; lo = hi)
+    {
+        uint32_t prio = r->replicators[lo]->priority;
+        for (hi = lo;
+             hi < r->n_replicators && r->replicators[hi]->priority == prio;
+             hi++)
         {
-            struct topic_registry_item_t* topic
-                = &par->address->registry.topic[j];
-            if (topic->to_subscribe == FALSE)
+        }
+        /* the order moves with (de)activations, find the replicator again */
+        for (first = lo; first < hi && r->replicators[first] != r->resume;
+             first++)
+        {
+        }
+        first = first < hi ? first : lo;
+        for (k = 0, i = first; k < hi - lo; k++, i = i + 1 < hi ? i + 1 : lo)
+        {
+            if (!topic_replicator_replicate(
+                    m, r->replicators[i], &budget, &r->stats)
+                && !out)
             {
-                /* only publish this topic, ignore */
-                continue;
+                out       = true;
+                r->resume = r->replicators[i];
             }
-
-            /* subscribe, requires a replicator */
-            struct topic_replicator_t* rep
-                = &par->replicators[par->n_replicators++];
-            struct topic_ring_t * external_ring = get_external_ring(par->address, topic);
-            topic_replicator_init(rep, topic->uuid, external_ring);
-            thinros_master_connect_topics(rep, i, m);
         }
     }
+    thinros_histogram_record(&r->stats.time, thinros_now() - budget.start);
 }
 
 void
 thinros_master_switch_to(struct thinros_master_t* m, size_t partition_idx)
 {
-    size_t i;
-
-    struct master_record_t* par = &m->partitions[partition_idx];
-    for (i = 0; i < par->n_replicators; i++)
+    if (m->broadcast.n_replicators > 0)
     {
-        struct topic_replicator_t* rep = &par->replicators[i];
-        topic_replicator_replicate(rep);
+        /* the broadcast rings first, they serve every partition */
+        thinros_master_replicate(m, &m->broadcast);
     }
+    thinros_master_replicate(m, &m->partitions[partition_idx]);
 }
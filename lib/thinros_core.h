@@ -64,6 +64,18 @@ time_ns(void)
          + (unsigned long long)tp.tv_nsec;
 }
 
+gcc_inline void
+sleep_until_ns(unsigned long long deadline)
+{
+    struct timespec tp;
+    tp.tv_sec  = deadline / 1000000000ull;
+    tp.tv_nsec = deadline % 1000000000ull;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &tp, NULL) != 0)
+    {
+        /* interrupted, sleep the remaining time */
+    }
+}
+
 #define ASSERT(x)                                                           \
     do                                                                      \
     {                                                                       \
@@ -136,16 +148,92 @@ time_ns(void)
 
 #endif /* linux kernel */
 
+#ifndef MODULE
+
+/*
+ * monotonic clock on the cycle counter: CNTVCT_EL0 on ARM64, the invariant
+ * TSC on x86 (calibrated against time_ns() on first use), time_ns() anywhere
+ * else. readings are in nanoseconds on the CLOCK_MONOTONIC time line.
+ */
+enum thinros_clock_source_t
+{
+    CLOCK_SOURCE_UNCALIBRATED = 0,
+    CLOCK_SOURCE_CALIBRATING,
+    CLOCK_SOURCE_COUNTER,
+    CLOCK_SOURCE_FALLBACK,
+};
+
+struct thinros_clock_t
+{
+    enum thinros_clock_source_t source;
+    uint64_t                    base_cycles;
+    uint64_t                    base_ns;
+    uint64_t                    mult; /* (ns per cycle) << 32 */
+};
+
+extern struct thinros_clock_t thinros_clock;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+void thinros_clock_init(void);
+#ifdef __cplusplus
+}
+#endif
+
+gcc_inline uint64_t
+thinros_cycles(void)
+{
+#if defined(__aarch64__)
+    uint64_t v;
+    __asm__ __volatile__("isb; mrs %0, cntvct_el0" : "=r"(v) : : "memory");
+    return v;
+#elif defined(__x86_64__)
+    uint32_t lo, hi;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#else
+    return 0;
+#endif
+}
+
+gcc_inline uint64_t
+thinros_now(void)
+{
+#if defined(__SIZEOF_INT128__)
+    if (likely(thinros_clock.source == CLOCK_SOURCE_COUNTER))
+    {
+        uint64_t d = thinros_cycles() - thinros_clock.base_cycles;
+        return thinros_clock.base_ns
+             + (uint64_t)(((unsigned __int128)d * thinros_clock.mult) >> 32);
+    }
+#endif
+    if (unlikely(thinros_clock.source != CLOCK_SOURCE_FALLBACK))
+    {
+        thinros_clock_init();
+        return thinros_now();
+    }
+    return time_ns();
+}
+
+#endif /* !MODULE */
+
 enum topic_data_status_t
 {
     TOPIC_EMPTY = 0,
     TOPIC_READY = 1,
 };
 
+/* origin of a message published in the partition of its ring */
+#define TOPIC_ORIGIN_LOCAL (0xfffffffflu)
+
 struct topic_data_t
 {
     enum topic_data_status_t status;
-    size_t                   timestamp;
+    uint32_t                 origin;     /* partition it was copied from */
+    size_t                   timestamp;  /* sequence number in the ring */
+    uint64_t                 published;  /* publish time (ns) */
+    uint64_t                 replicated; /* copy time to this ring, 0: local */
     uint8_t                  data[];
 };
 
@@ -204,14 +292,16 @@ struct topic_reader_t
     size_t               index;     /* current reading index */
     size_t               timestamp; /* current reading timestamp */
     struct topic_ring_t* ring;
-    enum topic_reader_data_status_t
-        read_ring[MAX_RING_ELEMS]; /* length = ring->n */
+    enum topic_reader_data_status_t* read_ring; /* length = ring->n */
 };
 
 #define TOPIC_RING_DEFINE(name, length, elem_type) \
     unsigned char                                  \
         name[(length) * (sizeof(struct topic_data_t) + sizeof(elem_type))]
 
+#define TOPIC_READER_STATE_DEFINE(name, length) \
+    enum topic_reader_data_status_t name[(length)]
+
 struct linear_allocator_t
 {
     size_t size;
@@ -219,37 +309,178 @@ struct linear_allocator_t
     uintptr_t memory;
 };
 
+/*
+ * allocator of the topic buffer, shared by all processes of a partition.
+ * blocks are rounded up to size classes a quarter power of 2 apart (at most
+ * 25% lost to rounding), a released block goes to the lock-free free list of
+ * its class and is handed out again before the buffer grows at `brk`. the
+ * space below `base` (static rings, registry, namespace) is never released.
+ */
+#define TOPIC_ALLOC_MIN_SHIFT (6lu) /* smallest block, 64 bytes */
+#define TOPIC_ALLOC_MAX_SHIFT (22lu)
+#define TOPIC_ALLOC_CLASSES   (1 + 4 * (TOPIC_ALLOC_MAX_SHIFT - TOPIC_ALLOC_MIN_SHIFT))
+
+static_assert(TOPIC_BUFFER_SIZE <= (1lu << TOPIC_ALLOC_MAX_SHIFT),
+    "the largest size class does not cover the topic buffer");
+
+#define TOPIC_BLOCK_USED (0x55534544u)
+#define TOPIC_BLOCK_FREE (0x46524545u)
+
+struct topic_block_t
+{
+    uint32_t size_class;
+    uint32_t magic;
+    uint64_t next;       /* next free block + 1, while on a free list */
+    uint64_t generation; /* of the registry, while retired */
+};
+
+struct topic_allocator_t
+{
+    size_t size;
+    size_t base; /* start of the releasable blocks */
+    atomic_t(size_t) brk;
+    atomic_t(size_t) in_use; /* bytes in allocated blocks */
+    uintptr_t memory;
+    atomic_t(uint64_t) free[TOPIC_ALLOC_CLASSES]; /* tag << 32 | block + 1 */
+    atomic_t(uint64_t) retired; /* blocks of removed topics, same format */
+};
+
 struct topic_namespace_item_t
 {
-    const char* const name;
-    const size_t      uuid;
-    const size_t      length;
-    const size_t      elem_sz;
+    char   name[TOPIC_NAME_SIZE]; /* nul-terminated */
+    size_t uuid;
+    size_t length;
+    size_t elem_sz;
 };
 
+/* compiled-in namespace, see THINROS_TOPICS */
 struct topic_namespace_t
 {
     size_t                        n;
     struct topic_namespace_item_t topic[MAX_TOPICS];
 };
 
+/*
+ * namespace with its lookup index, position independent so that it can be
+ * shared in a partition. the index is a perfect hash over the topic names
+ * (hash and displace): the name hash picks a bucket, the bucket's
+ * displacement picks a slot that no other name uses, so a lookup costs one
+ * hash and one string compare. uuids are indexed by open addressing. slots
+ * hold the topic index + 1, 0 is empty.
+ *
+ * behind `topic[max_topics]`, at `index_off`: displace[max_topics],
+ * by_name[max_slots], by_uuid[max_slots] and the scratch space of the build.
+ */
+struct topic_namespace_table_t
+{
+    atomic_t(size_t) built; /* number of topics indexed, 0: not built */
+    size_t                        n;
+    size_t                        max_topics;
+    size_t                        max_slots; /* power of 2 */
+    size_t                        n_buckets;
+    size_t                        n_slots;   /* power of 2 */
+    size_t                        index_off; /* from the table */
+    struct topic_namespace_item_t topic[];
+};
+
 typedef size_t relative_addr_t;
 
+#define INVALID_RELATIVE_ADDR ((relative_addr_t)-1)
+
+struct topic_layout_item_t
+{
+    size_t          uuid;
+    size_t          length;
+    size_t          elem_sz;
+    relative_addr_t local_ring;
+};
+
+/* compiled-in ring placement, see thinros_layout.h */
+struct topic_layout_t
+{
+    size_t                     n;
+    size_t                     size; /* bytes from the start of the buffer */
+    struct topic_layout_item_t topic[MAX_TOPICS];
+};
+
+/*
+ * the rings are allocated on first use: the local ring when the topic is
+ * advertised or subscribed in the partition, the external ring only when it
+ * is subscribed. INVALID_RELATIVE_ADDR until then.
+ */
 struct topic_registry_item_t
 {
     size_t          uuid;
+    size_t          length;
+    size_t          elem_sz;
+    bool            ready; /* filled in, set once by the registering process */
     bool            to_publish;
     bool            to_subscribe;
+    uint32_t        priority; /* highest of the subscribers, replication order */
+    bool            broadcast; /* subscribed through the broadcast ring */
     relative_addr_t local_ring;
     relative_addr_t external_ring;
+    relative_addr_t cursors; /* struct topic_cursor_t list */
 };
 
+/*
+ * read position of one subscription of a node, kept in the partition so that
+ * a restarted node picks up its reader state instead of allocating new one,
+ * see thinros_node_resume(). `ordinal` tells apart several subscriptions of
+ * the node to the same topic. the reader state of the local and the external
+ * ring follows the record.
+ */
+struct topic_cursor_t
+{
+    relative_addr_t next;
+    char            node_name[NODE_NAME_SIZE];
+    size_t          ordinal;
+    size_t          local_head; /* saved read positions */
+    size_t          local_tail;
+    size_t          external_head;
+    size_t          external_tail;
+    relative_addr_t local_state;
+    relative_addr_t external_state;
+};
+
+/*
+ * hash slot of the registry index. a process registers a uuid by claiming an
+ * empty slot with a CAS on `key`, so a uuid is registered once however many
+ * processes race for it; `item` is published once the item is filled in.
+ */
+struct topic_registry_slot_t
+{
+    uint64_t key;  /* uuid + 1, 0: empty, see TOPIC_REGISTRY_TOMBSTONE */
+    uint32_t item; /* idx + 1, 0 while the item is written */
+    uint32_t reserved;
+};
+
+#define topic_registry_key(uuid) ((uint64_t)(uuid) + 1)
+
+#define TOPIC_REGISTRY_FULL ((uint32_t)-1) /* claimed, no item left */
+
+#define TOPIC_REGISTRY_TOMBSTONE ((uint64_t)-1) /* a claim left by FULL */
+
+/*
+ * lives in the topic buffer behind the static rings, sized by the partition
+ * limits: `max_topics` items followed by `index_slots` hash slots. the item
+ * changed by generation g is logged in log[g % TOPIC_REGISTRY_LOG] as
+ * g << 32 | idx, so the master visits only the items that changed.
+ */
 struct topic_registry_t
 {
-    size_t                       n;
-    struct topic_registry_item_t topic[MAX_TOPICS];
+    atomic_t(size_t)             n;          /* items claimed */
+    atomic_t(size_t)             generation; /* bumped on (un)wiring changes */
+    size_t                       max_topics;
+    size_t                       index_slots; /* power of 2 */
+    size_t                       index_off;   /* from the registry */
+    atomic_t(uint64_t)           log[TOPIC_REGISTRY_LOG];
+    struct topic_registry_item_t topic[];
 };
 
+#define topic_registry_index(reg)                                      \
+    ((struct topic_registry_slot_t*)((uintptr_t)(reg) + (reg)->index_off))
+
 enum partition_status_t
 {
     PARTITION_UNINITIALIZED = 0,
@@ -259,16 +490,60 @@ enum partition_status_t
     PARTITION_SHUTDOWN,
 };
 
+struct topic_partition_limits_t
+{
+    size_t max_topics;     /* registry capacity */
+    size_t max_ring_elems; /* longest ring a topic may ask for */
+};
+
+/*
+ * the cycle counter calibration of the process that laid out the partition,
+ * or of the master once it added the partition (thinros_master_add), adopted
+ * by the processes attaching to it so that their thinros_now() readings
+ * agree instead of drifting apart by their own calibration errors
+ */
+struct topic_partition_clock_t
+{
+    uint64_t base_cycles;
+    uint64_t base_ns;
+    uint64_t mult; /* 0: not on a cycle counter */
+};
+
+#define TOPIC_PARTITION_DEFAULT_LIMITS                                  \
+    {                                                                   \
+        .max_topics = DEFAULT_PARTITION_TOPICS,                         \
+        .max_ring_elems = DEFAULT_RING_ELEMS,                           \
+    }
+
+/* memory of a partition's topic buffer, see topic_partition_usage() */
+struct topic_partition_usage_t
+{
+    size_t size;           /* topic buffer */
+    size_t reserved;       /* static rings, registry and namespace */
+    size_t in_use;         /* blocks allocated, with headers and rounding */
+    size_t released;       /* blocks on the free lists */
+    size_t available;      /* never handed out */
+    size_t local_rings;    /* allocated rings of the registered topics */
+    size_t external_rings;
+};
+
+/* bump on incompatible changes of the structures shared in a partition */
+#define THINROS_PARTITION_FORMAT (5lu)
+
 /**
  * Notice: do not instantiate to a local variable
  */
 struct topic_partition_t
 {
-    size_t                    partition_id;
-    enum partition_status_t   status;
-    struct topic_registry_t   registry;
-    struct linear_allocator_t allocator;
-    uint8_t                   topic_buffer[TOPIC_BUFFER_SIZE];
+    size_t                          partition_id;
+    enum partition_status_t         status;
+    uint64_t                        version; /* topic_partition_version() */
+    struct topic_partition_limits_t limits;
+    struct topic_partition_clock_t  clock;
+    relative_addr_t                 registry;  /* struct topic_registry_t */
+    relative_addr_t                 names;     /* topic_namespace_table_t */
+    struct topic_allocator_t        allocator;
+    uint8_t                         topic_buffer[TOPIC_BUFFER_SIZE];
 } gcc_4k_aligned;
 
 struct publisher_t
@@ -280,22 +555,134 @@ struct publisher_t
 
 typedef void (*thinros_callback_on_t)(void* data);
 
+/*
+ * dispatch priority of a subscription, higher classes are serviced first in
+ * each spin. classes below PRIO_HIGH are subject to the node time budget.
+ */
+enum thinros_priority_t
+{
+    PRIO_LOW = 0,
+    PRIO_NORMAL,
+    PRIO_HIGH,
+    PRIO_CRITICAL,
+
+    MAX_PRIORITIES
+};
+
+#define NO_DEADLINE (0llu)
+
+/*
+ * where a subscription of a restarted node starts reading, see
+ * thinros_node_resume(). a subscription the node never had starts with the
+ * messages still in the rings.
+ */
+enum thinros_resume_t
+{
+    RESUME_AT_HEAD = 0, /* skip what was published while the node was down */
+    RESUME_AT_SAVED,    /* continue after the last message dispatched */
+};
+
+/*
+ * log-linear latency histogram: values below 2^HIST_SUB_BITS are counted
+ * exactly, above that each power of two is split in 2^HIST_SUB_BITS buckets,
+ * i.e. a relative error below 1/2^HIST_SUB_BITS.
+ */
+#define HIST_SUB_BUCKETS (1lu << HIST_SUB_BITS)
+#define HIST_BUCKETS     ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+
+struct thinros_histogram_t
+{
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+    uint32_t bucket[HIST_BUCKETS];
+};
+
+struct thinros_latency_t
+{
+    struct thinros_histogram_t delivery;    /* publish to callback */
+    struct thinros_histogram_t replication; /* publish to external ring */
+};
+
 struct subscriber_t
 {
-    size_t                topic_uuid;
-    thinros_callback_on_t callback;
-    struct topic_reader_t local_reader;
-    struct topic_reader_t external_reader;
+    struct subscriber_t*     next; /* in the node */
+    size_t                   topic_uuid;
+    thinros_callback_on_t    callback;
+    enum thinros_priority_t  priority;
+    uint64_t                 deadline; /* relative deadline (ns), EDF order */
+    uint64_t                 release;  /* when pending messages were seen */
+    struct thinros_latency_t latency;
+    struct topic_reader_t    local_reader;
+    struct topic_reader_t    external_reader;
+    struct topic_cursor_t*   cursor; /* in the partition */
+};
+
+#define TIMER_WHEEL_SLOTS (1lu << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_MASK  (TIMER_WHEEL_SLOTS - 1)
+
+/*
+ * timers are linked into the slots of a hierarchical wheel. level 0 holds
+ * timers due within TIMER_WHEEL_SLOTS ticks, level l those due within
+ * TIMER_WHEEL_SLOTS^(l+1) ticks; higher levels are cascaded down whenever the
+ * lower level wraps around.
+ */
+struct thinros_timer_t
+{
+    struct thinros_timer_t*       next;
+    struct thinros_timer_t**      pprev;
+    struct thinros_timer_wheel_t* wheel;
+    uint64_t                      expires;  /* absolute time (ns) */
+    uint64_t                      period;   /* 0: one-shot */
+    size_t                        overruns; /* missed periods */
+    thinros_callback_on_t         callback;
+    void*                         arg;
+};
+
+struct thinros_timer_wheel_t
+{
+    uint64_t                tick; /* current tick, cascaded */
+    size_t                  n_timers;
+    struct thinros_timer_t* slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+};
+
+/*
+ * how the spinning thread runs, applied once by thinros_spin, or to any
+ * thread with thinros_exec_apply_config()
+ */
+struct thinros_exec_config_t
+{
+    uint64_t cpu_mask;           /* cpus to pin to, 0: leave affinity alone */
+    int      sched_priority;     /* SCHED_FIFO priority, 0: keep the policy */
+    bool     lock_memory;        /* mlockall current and future pages */
+    bool     prefault_partition; /* touch every page of the topic buffer */
+    size_t   prefault_stack;     /* bytes of stack to touch up front */
+};
+
+struct thinros_dispatch_stats_t
+{
+    uint64_t worst;      /* worst-case dispatch latency (ns) */
+    size_t   dispatched; /* number of subscription dispatches */
+    size_t   deferred;   /* dispatches postponed by the time budget */
 };
 
 struct node_handle_t
 {
     atomic_t(bool) running;
-    struct topic_partition_t* par;
-    char                      node_name[NODE_NAME_SIZE];
-    size_t                    n_subscribers;
-    struct subscriber_t*      subscribers[MAX_TOPICS_SUBSCRIBE];
-    uint8_t                   buffer[MAX_MESSAGE_SIZE];
+    struct topic_partition_t*       par;
+    struct topic_partition_t*       broadcast; /* broadcast rings, or NULL */
+    char                            node_name[NODE_NAME_SIZE];
+    size_t                          n_subscribers;
+    struct subscriber_t*            subscribers; /* in registration order */
+    struct subscriber_t**           subscribers_tail;
+    uint64_t                        budget; /* per-spin budget (ns), 0: none */
+    enum thinros_resume_t           resume;
+    struct thinros_dispatch_stats_t stats[MAX_PRIORITIES];
+    struct thinros_timer_wheel_t    timers;
+    struct thinros_exec_config_t    exec;
+    bool                            exec_applied;
+    uint8_t                         buffer[MAX_MESSAGE_SIZE];
 };
 
 /**
@@ -312,23 +699,68 @@ struct node_handle_t
  */
 struct topic_replicator_t
 {
-    size_t                topic_uuid;
-    size_t                n_sources;
-    struct topic_reader_t sources[MAX_PARTITIONS];
-    struct topic_writer_t destination;
+    size_t                 topic_uuid;
+    uint32_t               priority;  /* enum thinros_priority_t */
+    size_t                 length;    /* ring elements of the subscriber */
+    size_t                 slot;      /* in the active replicators */
+    size_t                 readers;   /* partitions of a broadcast ring */
+    size_t                 n_sources; /* connected, the first of `sources` */
+    struct topic_reader_t* sources;   /* max_partitions, keep their state */
+    size_t*                origins;   /* partition of each source */
+    size_t*                counted;   /* head its deferrals are counted to */
+    struct topic_writer_t  destination;
+};
+
+/* rings of a registry item the master has wired */
+struct master_wiring_t
+{
+    relative_addr_t published;  /* local ring read by other replicators */
+    relative_addr_t subscribed; /* external ring written by the replicator */
+    bool            broadcast;  /* reads the broadcast ring of the topic */
+};
+
+/* replication on the switches to a partition */
+struct thinros_replication_stats_t
+{
+    struct thinros_histogram_t time; /* per switch (ns) */
+    uint64_t                   copied;   /* messages */
+    uint64_t                   skipped;  /* sources without new messages */
+    uint64_t                   deferred; /* left to a later switch, once */
+    uint64_t                   dropped;  /* overwritten before copied */
 };
 
 struct master_record_t
 {
-    struct topic_partition_t* address;
-    struct topic_replicator_t replicators[MAX_TOPICS];
-    size_t                    n_replicators;
+    struct topic_partition_t*   address;
+    struct topic_replicator_t** replicators; /* active, by priority */
+    size_t                      n_replicators;
+    struct topic_replicator_t** by_item;    /* per registry item, or NULL */
+    struct master_wiring_t*     wiring;     /* per registry item */
+    size_t                      generation; /* of the registry when wired */
+    struct topic_replicator_t*  resume; /* where the budget ran out */
+    struct thinros_replication_stats_t stats;
 };
 
+/*
+ * the tables of the master are carved from a caller-provided arena in secure
+ * memory and sized at runtime; thinros_master_build rebuilds them from the
+ * end of the partition table, thinros_master_update extends them. a
+ * replicator belongs to a registry item for good, so that it and the reader
+ * state of its sources are reused when the topic is wired again.
+ * replication on a switch runs by topic priority, see thinros_master_budget.
+ * with a broadcast partition (thinros_master_broadcast), `broadcast` holds
+ * one replicator per topic feeding its broadcast ring.
+ */
 struct thinros_master_t
 {
-    size_t                 n_partitions;
-    struct master_record_t partitions[MAX_PARTITIONS];
+    size_t                    n_partitions;
+    size_t                    max_partitions;
+    struct master_record_t*   partitions;
+    struct master_record_t    broadcast; /* address NULL: none */
+    struct linear_allocator_t arena;
+    size_t                    tables;       /* arena offset of the replicators */
+    size_t                    budget_bytes; /* per switch, 0: none */
+    uint64_t                  budget_ns;    /* per switch, 0: none */
 };
 
 enum thinros_spin_type_t
@@ -337,6 +769,8 @@ enum thinros_spin_type_t
     SPIN_FOREVER,
     SPIN_YIELD,
     SPIN_TIMEOUT,
+    SPIN_SLEEP, /* sleep until the next timer, polling at most `nanoseconds`;
+                   without polling, returns once no timer is armed */
 
     MAX_SPIN_TYPES
 };
@@ -354,11 +788,21 @@ void topic_reader_print(struct topic_reader_t *rd);
 void thinros_subscriber_print(struct subscriber_t * s);
 void thinros_publisher_print(struct publisher_t * p);
 void thinros_node_print(struct node_handle_t * n);
+void thinros_node_print_dispatch(struct node_handle_t * n);
+void thinros_node_print_latency(struct node_handle_t * n);
+void thinros_subscriber_print_latency(struct subscriber_t * s);
+void thinros_histogram_print(struct thinros_histogram_t * h);
 
 void topic_partition_print(struct topic_partition_t * par);
 void thinros_master_print(struct thinros_master_t * m);
 /*-- end of debug functions --*/
 
+/* -- histogram -- */
+void thinros_histogram_reset(struct thinros_histogram_t * h);
+void thinros_histogram_record(struct thinros_histogram_t * h, uint64_t v);
+uint64_t thinros_histogram_percentile(struct thinros_histogram_t * h, double p);
+/* ---- */
+
 /* -- topic ring -- */
 void topic_ring_init(struct topic_ring_t * p_ring, size_t n, size_t elem_sz);
 size_t topic_ring_alloc(struct topic_ring_t *r);
@@ -368,7 +812,8 @@ struct topic_data_t * topic_writer_next_avail(struct topic_writer_t * w);
 void topic_writer_complete(struct topic_writer_t * w);
 struct topic_data_t * topic_writer_write(struct topic_writer_t * w, void * src, size_t sz);
 
-void topic_reader_init(struct topic_reader_t * rd, struct topic_ring_t *r);
+void topic_reader_init(struct topic_reader_t * rd, struct topic_ring_t *r,
+					   enum topic_reader_data_status_t * read_ring);
 struct topic_data_t * topic_reader_read_next(struct topic_reader_t *rd);
 struct topic_data_t * topic_reader_read_eager(struct topic_reader_t *rd);
 bool topic_reader_complete(struct topic_reader_t * rd);
@@ -379,39 +824,107 @@ size_t topic_ring_copy(struct topic_reader_t * rd, struct topic_writer_t * wr);
 
 /* -- linear allocator -- */
 void linear_allocator_init(struct linear_allocator_t * la, size_t total_sz);
-uintptr_t linear_allocator_alloc(struct linear_allocator_t * la, size_t sz);
+size_t linear_allocator_alloc(struct linear_allocator_t * la, size_t sz);
 /* ---- */
 
 /* -- partition -- */
-struct topic_namespace_item_t * topic_namespace_query_by_name(char * name);
+uint64_t topic_name_hash(const char * name);
+size_t topic_namespace_table_size(size_t max_topics);
+void topic_namespace_table_init(struct topic_namespace_table_t * t, size_t max_topics);
+bool topic_namespace_table_add(struct topic_namespace_table_t * t, const char * name,
+							   size_t uuid, size_t length, size_t elem_sz);
+void topic_namespace_table_build(struct topic_namespace_table_t * t);
+struct topic_namespace_item_t * topic_namespace_table_query_by_name(
+	struct topic_namespace_table_t * t, const char * name);
+struct topic_namespace_item_t * topic_namespace_table_query_by_uuid(
+	struct topic_namespace_table_t * t, size_t uuid);
+
+void topic_namespace_index_build(void);
+struct topic_namespace_table_t * topic_namespace_compiled(void);
+struct topic_namespace_item_t * topic_namespace_query_by_name(const char * name);
 struct topic_namespace_item_t * topic_namespace_query_by_uuid(size_t uuid);
 
 struct topic_ring_t * get_local_ring(struct topic_partition_t * par, struct topic_registry_item_t * topic);
 struct topic_ring_t * get_external_ring(struct topic_partition_t * par, struct topic_registry_item_t * topic);
+struct topic_ring_t * topic_partition_local_ring(struct topic_partition_t * par, struct topic_registry_item_t * topic);
+struct topic_ring_t * topic_partition_external_ring(struct topic_partition_t * par, struct topic_registry_item_t * topic);
 
 struct topic_registry_item_t * topic_registry_query(struct topic_registry_t * reg, size_t uuid);
+struct topic_registry_item_t * topic_registry_at(struct topic_registry_t * reg, size_t idx);
+struct topic_registry_t * topic_partition_registry(struct topic_partition_t * par);
+struct topic_namespace_table_t * topic_partition_namespace(struct topic_partition_t * par);
+relative_addr_t topic_partition_alloc(struct topic_partition_t * par, size_t sz);
+void topic_partition_free(struct topic_partition_t * par, relative_addr_t ra);
+uint64_t topic_partition_version(void);
+bool topic_partition_compatible(struct topic_partition_t * par);
 void topic_partition_init(struct topic_partition_t * par);
+void topic_partition_init_limits(struct topic_partition_t * par,
+								 const struct topic_partition_limits_t * limits);
+void topic_partition_init_namespace(struct topic_partition_t * par,
+									const struct topic_partition_limits_t * limits,
+									const struct topic_namespace_table_t * names);
 void topic_nonsecure_partition_init(struct topic_partition_t* par);
 struct topic_registry_item_t * topic_partition_get(struct topic_partition_t * par, size_t uuid);
-struct topic_registry_item_t * topic_partition_get_by_name(struct topic_partition_t *par, char *topic_name);
-void thinros_node(struct node_handle_t * n, struct topic_partition_t * par, char * node_name);
+struct topic_registry_item_t * topic_partition_get_by_name(struct topic_partition_t *par, const char *topic_name);
+bool topic_partition_remove(struct topic_partition_t * par, size_t uuid);
+size_t topic_partition_reclaim(struct topic_partition_t * par, size_t generation);
+void topic_partition_usage(struct topic_partition_t * par,
+						  struct topic_partition_usage_t * usage);
+void thinros_node(struct node_handle_t * n, struct topic_partition_t * par, const char * node_name);
 void thinros_advertise(_out struct publisher_t *publisher,
-					   _in struct node_handle_t *n, _in char *topic_name);
+					   _in struct node_handle_t *n, _in const char *topic_name);
+void thinros_advertise_uuid(_out struct publisher_t *publisher,
+					   _in struct node_handle_t *n, _in size_t uuid);
 void thinros_publish(_in struct publisher_t *publisher, _in void *message,
 					 _in size_t sz);
 void thinros_subscribe(_in struct subscriber_t * subscriber,
-					   _in struct node_handle_t * n, _in char * topic_name,
+					   _in struct node_handle_t * n, _in const char * topic_name,
 					   _in thinros_callback_on_t callback);
+void thinros_subscribe_prio(_in struct subscriber_t * subscriber,
+					   _in struct node_handle_t * n, _in const char * topic_name,
+					   _in thinros_callback_on_t callback,
+					   _in enum thinros_priority_t priority,
+					   _in uint64_t deadline);
+void thinros_subscribe_uuid(_in struct subscriber_t * subscriber,
+					   _in struct node_handle_t * n, _in size_t uuid,
+					   _in thinros_callback_on_t callback,
+					   _in enum thinros_priority_t priority,
+					   _in uint64_t deadline);
+void thinros_node_budget(_in struct node_handle_t * n, _in uint64_t nanoseconds);
+void thinros_node_broadcast(_in struct node_handle_t * n, _in struct topic_partition_t * par);
+void thinros_node_resume(_in struct node_handle_t * n, _in enum thinros_resume_t resume);
+void thinros_node_exec(_in struct node_handle_t * n,
+					   _in const struct thinros_exec_config_t * cfg);
+void thinros_timer_periodic(_out struct thinros_timer_t * timer,
+					   _in struct node_handle_t * n, _in uint64_t period,
+					   _in thinros_callback_on_t callback, _in void * arg);
+void thinros_timer_oneshot(_out struct thinros_timer_t * timer,
+					   _in struct node_handle_t * n, _in uint64_t delay,
+					   _in thinros_callback_on_t callback, _in void * arg);
+void thinros_timer_cancel(_in struct thinros_timer_t * timer);
 void thinros_spin(_in struct node_handle_t * n,
 					_in enum thinros_spin_type_t type,
 					_in void (*yield)(void),
 					_in uint64_t nanoseconds);
 /* ---- */
 
+/* -- platform -- */
+bool thinros_exec_apply(_in struct node_handle_t * n);
+/* the calling thread, `par` (or NULL) is prefaulted if `cfg` asks for it */
+bool thinros_exec_apply_config(_in const struct thinros_exec_config_t * cfg,
+					   _in struct topic_partition_t * par);
+/* ---- */
+
 /* -- master (secure only) -- */
-__secure void thinros_master_init(struct thinros_master_t * m);
+__secure void thinros_master_init(struct thinros_master_t * m, size_t max_partitions,
+									void * arena, size_t arena_sz);
 __secure void thinros_master_add(struct thinros_master_t * m, struct topic_partition_t * par);
+__secure void thinros_master_broadcast(struct thinros_master_t * m, struct topic_partition_t * par);
 __secure void thinros_master_build(struct thinros_master_t * m);
+__secure size_t thinros_master_update(struct thinros_master_t * m);
+__secure void thinros_master_stats_reset(struct thinros_master_t * m, size_t idx);
+__secure void thinros_master_budget(struct thinros_master_t * m, size_t bytes,
+									uint64_t nanoseconds);
 __secure void thinros_master_switch_to(struct thinros_master_t * m, size_t partition_idx);
 /* ---- */
 
@@ -0,0 +1,59 @@
+#ifndef _THINROS_IOCTL_H_
+#define _THINROS_IOCTL_H_
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/*
+ * control plane of the thinros character devices, /dev/thinros for the
+ * first partition region and /dev/thinros<i> for region i (see the driver's
+ * `partitions`). a region holds `n_partitions` struct topic_partition_t back
+ * to back; offsets are from the start of the region, i.e. the mmap offset
+ * that maps them, so that a process maps only the pages it uses.
+ */
+
+#define THINROS_IOC_MAGIC   ('t')
+#define THINROS_IOC_NO_RING (~0ull) /* ring not allocated yet */
+
+struct thinros_ioc_geometry
+{
+    __u32 region;         /* index of the device's region */
+    __u32 n_partitions;   /* struct topic_partition_t in the region */
+    __u64 region_size;    /* NONSECURE_PARTITION_SIZE */
+    __u64 partition_size; /* sizeof(struct topic_partition_t) */
+    __u64 topic_buffer;   /* offset of topic_buffer in a partition */
+};
+
+struct thinros_ioc_status
+{
+    __u32 partition; /* in: index in the region */
+    __u32 status;    /* enum partition_status_t */
+    __u64 version;   /* topic_partition_version() of the initializing build */
+    __u64 topics;    /* registered */
+    __u64 max_topics;
+    __u64 reserved; /* topic buffer bytes before the allocated blocks */
+    __u64 brk;      /* end of the allocated part of the topic buffer */
+    __u64 in_use;   /* bytes in allocated blocks */
+};
+
+#define THINROS_IOC_PUBLISHED  (1u << 0)
+#define THINROS_IOC_SUBSCRIBED (1u << 1)
+
+struct thinros_ioc_topic
+{
+    __u32 partition; /* in: index in the region */
+    __u32 flags;     /* THINROS_IOC_PUBLISHED | THINROS_IOC_SUBSCRIBED */
+    __u64 uuid;      /* in */
+    __u64 length;
+    __u64 elem_sz;
+    __u64 local_ring;    /* region offset or THINROS_IOC_NO_RING */
+    __u64 external_ring; /* region offset or THINROS_IOC_NO_RING */
+    __u64 ring_size;     /* bytes of each ring */
+};
+
+#define THINROS_IOC_GEOMETRY \
+    _IOR(THINROS_IOC_MAGIC, 1, struct thinros_ioc_geometry)
+#define THINROS_IOC_STATUS _IOWR(THINROS_IOC_MAGIC, 2, struct thinros_ioc_status)
+#define THINROS_IOC_TOPIC  _IOWR(THINROS_IOC_MAGIC, 3, struct thinros_ioc_topic)
+
+#endif /* !_THINROS_IOCTL_H_ */
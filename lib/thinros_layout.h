@@ -0,0 +1,55 @@
+#ifndef _THINROS_LAYOUT_H_
+#define _THINROS_LAYOUT_H_
+
+#include "thinros_core.h"
+
+/*
+ * static partition layout of the compiled-in scenario, computed by the
+ * preprocessor from THINROS_TOPICS: the local ring of every topic is placed
+ * back to back at the start of the topic buffer, e.g.
+ * THINROS_LAYOUT_LOCAL_fwd_scan is the relative address of the local ring
+ * of `fwd_scan`. topic_partition_init stamps these rings and their registry
+ * entries in one pass. external rings are only needed in the partitions
+ * subscribing to the topic, they are allocated on the first subscription.
+ */
+
+#define THINROS_RING_BYTES(length, type)                             \
+    ((sizeof(struct topic_ring_t)                                    \
+         + (length) * (sizeof(struct topic_data_t) + sizeof(type))   \
+         + PADDING_BYTES + 7)                                        \
+        & ~7lu)
+
+/* running sum over the topics: each enumerator ends one before the next */
+#define THINROS_LAYOUT_OFFSETS(topic, id, len, type)                      \
+    THINROS_LAYOUT_LOCAL_##topic,                                         \
+    THINROS_LAYOUT_END_##topic                                            \
+        = THINROS_LAYOUT_LOCAL_##topic + THINROS_RING_BYTES(len, type) - 1,
+
+enum thinros_layout_offset_t
+{
+    THINROS_LAYOUT_BASE = -1,
+    THINROS_TOPICS(THINROS_LAYOUT_OFFSETS)
+    THINROS_LAYOUT_SIZE /* bytes taken by the scenario rings */
+};
+
+#define THINROS_LAYOUT_COUNT(topic, id, len, type) +1
+#define THINROS_LAYOUT_TOPICS (0 THINROS_TOPICS(THINROS_LAYOUT_COUNT))
+
+#define THINROS_LAYOUT_CHECK(topic, id, len, type)                    \
+    static_assert((len) > 0 && (len) <= DEFAULT_RING_ELEMS,           \
+        "ring of `" #topic "` exceeds DEFAULT_RING_ELEMS");
+
+THINROS_TOPICS(THINROS_LAYOUT_CHECK)
+
+static_assert(THINROS_LAYOUT_SIZE <= TOPIC_BUFFER_SIZE,
+    "the rings of the scenario do not fit in TOPIC_BUFFER_SIZE");
+static_assert(THINROS_LAYOUT_TOPICS <= DEFAULT_PARTITION_TOPICS,
+    "the scenario has more topics than DEFAULT_PARTITION_TOPICS");
+
+#define THINROS_LAYOUT_ITEM(topic, id, len, type)    \
+    { .uuid       = id,                              \
+      .length     = len,                             \
+      .elem_sz    = sizeof(type),                    \
+      .local_ring = THINROS_LAYOUT_LOCAL_##topic },
+
+#endif /* !_THINROS_LAYOUT_H_ */
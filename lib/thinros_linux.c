@@ -1,30 +1,311 @@
+#define _GNU_SOURCE
+#include <alloca.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <sched.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "thinros_linux.h"
 #include "thinros_core.h"
+#include "thinros_ioctl.h"
 
-#define n_devpath				"/proc/thinros"
+#define n_devpath				"/dev/thinros"
+#define n_shm_name				"/thinros"
+#define n_shm_wait_ms			(1000)
+#define n_splice_pipe_size		(1024 * 1024)
 
-struct thinros_ipc* thinros_bind(void)
+static const struct
 {
-    struct thinros_ipc* ipc = malloc(sizeof(struct thinros_ipc));
+    const char*  name;
+    unsigned int flag;
+} thinros_bind_options[] = {
+    { "huge", THINROS_BIND_HUGE_PAGES },
+    { "prefault", THINROS_BIND_PREFAULT },
+    { "lock", THINROS_BIND_LOCK },
+    { "shm", THINROS_BIND_SHM },
+    { "sparse", THINROS_BIND_SPARSE },
+    { "readonly", THINROS_BIND_READONLY },
+};
+
+#define n_bind_options \
+    (sizeof(thinros_bind_options) / sizeof(thinros_bind_options[0]))
 
-    ipc->fd = open(n_devpath, O_RDWR | O_SYNC);
-    if (ipc->fd < 0)
+static unsigned int thinros_bind_parse(const char* options)
+{
+    unsigned int flags = 0;
+    char         word[32];
+    size_t       i, len;
+
+    while (options != NULL && *options != '\0')
     {
-        perror(
-            "cannot open file, please check if thinros driver is installed.\n");
-        free(ipc);
-        return NULL;
+        len = strcspn(options, ",");
+        snprintf(word, sizeof(word), "%.*s", (int)len, options);
+        for (i = 0; i < n_bind_options; i++)
+        {
+            if (strcmp(word, thinros_bind_options[i].name) == 0)
+            {
+                flags |= thinros_bind_options[i].flag;
+                break;
+            }
+        }
+        if (len > 0 && i == n_bind_options)
+        {
+            fprintf(stderr, "THINROS_BIND: unknown option `%s`\n", word);
+        }
+        options += options[len] == ',' ? len + 1 : len;
+    }
+    return flags;
+}
+
+/**
+ * pick the page size of the mapping before the first touch: the driver maps
+ * 2 MB at a time on a fault only where the vma asks for huge pages
+ */
+static void thinros_bind_pages(struct thinros_ipc* ipc, unsigned int flags)
+{
+    if (flags & THINROS_BIND_HUGE_PAGES)
+    {
+        if (((uintptr_t)ipc->par & (2 * _1m - 1)) != 0
+            || madvise(ipc->par, ipc->size, MADV_HUGEPAGE) != 0)
+        {
+            perror("cannot map the partition with huge pages, using 4 KB");
+        }
+    }
+    else
+    {
+        /* ignored if the driver maps the partition at once */
+        madvise(ipc->par, ipc->size, MADV_NOHUGEPAGE);
+    }
+}
+
+/**
+ * take the faults of the whole mapping now, after thinros_bind_pages() chose
+ * the page size. every page is read once: MAP_POPULATE would fault before
+ * the madvise, and the kernel skips it on the pfn mapping of the driver.
+ */
+static void thinros_bind_prefault(struct thinros_ipc* ipc, unsigned int flags)
+{
+    volatile uint8_t* base = (volatile uint8_t*)ipc->par;
+    size_t            page = (size_t)sysconf(_SC_PAGESIZE);
+
+    if (flags & THINROS_BIND_PREFAULT)
+    {
+        for (size_t i = 0; i < ipc->size; i += page)
+        {
+            /* read only, the partition may be in use by other nodes */
+            (void)base[i];
+        }
+    }
+    if ((flags & THINROS_BIND_LOCK)
+        && mlock(ipc->par, ipc->size) != 0)
+    {
+        perror("cannot lock the partition (mlock)");
+    }
+}
+
+/**
+ * /dev/thinros<partition> of the driver or the shared memory object
+ * <shm_name><partition>, without the number for partition 0
+ */
+static void thinros_bind_path(
+    const struct thinros_bind_config_t* cfg, char* path, size_t sz)
+{
+    const char* base = n_devpath;
+
+    if (cfg->flags & THINROS_BIND_SHM)
+    {
+        base = cfg->shm_name != NULL ? cfg->shm_name
+             : getenv("THINROS_SHM") != NULL ? getenv("THINROS_SHM")
+                                             : n_shm_name;
+    }
+    if (cfg->partition == 0)
+    {
+        snprintf(path, sz, "%s", base);
+    }
+    else
+    {
+        snprintf(path, sz, "%s%u", base, cfg->partition);
+    }
+}
+
+static void thinros_sleep_ms(long ms)
+{
+    struct timespec ts = { .tv_sec = ms / 1000, .tv_nsec = ms % 1000 * 1000000 };
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * open the shared memory object, created zeroed at the partition size if it
+ * does not exist yet. `*created` tells the process expected to initialize it.
+ * `readonly` never creates it, it waits for the writer to.
+ */
+static int thinros_shm_open(const char* name, bool readonly, bool* created)
+{
+    struct stat st;
+    int         fd = -1, ms;
+
+    *created = false;
+    if (!readonly)
+    {
+        fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0666);
     }
+    if (fd >= 0)
+    {
+        *created = true;
+        /* open to every user, like the driver's device nodes */
+        if (fchmod(fd, 0666) != 0 || ftruncate(fd, NONSECURE_PARTITION_SIZE) != 0)
+        {
+            perror("cannot size the shared memory partition (ftruncate)");
+            close(fd);
+            shm_unlink(name);
+            return -1;
+        }
+        return fd;
+    }
+
+    for (ms = 0; (fd = shm_open(name, readonly ? O_RDONLY : O_RDWR, 0)) < 0
+                 && readonly && errno == ENOENT && ms < n_shm_wait_ms;
+         ms++)
+    {
+        thinros_sleep_ms(1);
+    }
+    if (fd < 0)
+    {
+        perror("cannot open the shared memory partition (shm_open)");
+        return -1;
+    }
+    /* the creator may not have sized it yet */
+    for (ms = 0; fstat(fd, &st) == 0 && st.st_size == 0 && ms < n_shm_wait_ms;
+         ms++)
+    {
+        thinros_sleep_ms(1);
+    }
+    if (st.st_size != NONSECURE_PARTITION_SIZE)
+    {
+        fprintf(stderr,
+            "shared memory partition %s has %ld bytes, expected %lu\n", name,
+            (long)st.st_size, (unsigned long)NONSECURE_PARTITION_SIZE);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * map the first `size` bytes of the shared memory object or the driver region
+ * 2 MB aligned, which thinros_bind_pages() needs for huge pages. the space is
+ * reserved at `hint` if it is free, anywhere else otherwise.
+ */
+static void* thinros_bind_map(int fd, size_t size, int prot, void* hint)
+{
+    size_t   slack = 2 * _1m, head;
+    uint8_t* raw   = mmap(hint, size + slack, PROT_NONE,
+          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    uint8_t* base;
+
+    if (raw == MAP_FAILED)
+    {
+        return MAP_FAILED;
+    }
+    head = (slack - ((uintptr_t)raw & (slack - 1))) & (slack - 1);
+    base = mmap(raw + head, size, prot, MAP_SHARED | MAP_FIXED, fd, 0);
+    if (base == MAP_FAILED)
+    {
+        munmap(raw, size + slack);
+        return MAP_FAILED;
+    }
+    if (head > 0)
+    {
+        munmap(raw, head);
+    }
+    munmap(base + size, slack - head);
+    return base;
+}
+
+/**
+ * check that the driver lays out the region as this build does, before the
+ * partition is mapped. drivers without the ioctl are trusted.
+ */
+static bool thinros_bind_geometry(int fd)
+{
+    struct thinros_ioc_geometry g;
+
+    if (ioctl(fd, THINROS_IOC_GEOMETRY, &g) != 0)
+    {
+        return true;
+    }
+    if (g.region_size != NONSECURE_PARTITION_SIZE
+        || g.partition_size != sizeof(struct topic_partition_t)
+        || g.topic_buffer != offsetof(struct topic_partition_t, topic_buffer))
+    {
+        fprintf(stderr,
+            "thinros driver region %u has partitions of %llu bytes in %llu, "
+            "expected %lu in %lu\n",
+            g.region, (unsigned long long)g.partition_size,
+            (unsigned long long)g.region_size,
+            (unsigned long)sizeof(struct topic_partition_t),
+            (unsigned long)NONSECURE_PARTITION_SIZE);
+        return false;
+    }
+    return true;
+}
 
-    ipc->par = mmap((void *) NONSECURE_PARTITION_LOC, NONSECURE_PARTITION_SIZE, PROT_READ | PROT_WRITE,
-        MAP_SHARED, ipc->fd, 0);
+struct thinros_ipc* thinros_bind_config(const struct thinros_bind_config_t* cfg)
+{
+    struct thinros_ipc* ipc     = malloc(sizeof(struct thinros_ipc));
+    bool                created  = false;
+    bool                readonly = (cfg->flags & THINROS_BIND_READONLY) != 0;
+    int                 prot     = readonly ? PROT_READ : PROT_READ | PROT_WRITE;
+    char                path[256];
+    int                 ms;
+
+    thinros_bind_path(cfg, path, sizeof(path));
+    ipc->pipe[0] = ipc->pipe[1] = -1;
+    ipc->size = NONSECURE_PARTITION_SIZE;
+    if (cfg->flags & THINROS_BIND_SPARSE)
+    {
+        /* the partition the nodes use, not the rest of the region */
+        ipc->size = (sizeof(struct topic_partition_t) + 4 * _1k - 1)
+                  & ~(4 * _1k - 1);
+    }
+    if (cfg->flags & THINROS_BIND_SHM)
+    {
+        ipc->fd = thinros_shm_open(path, readonly, &created);
+        if (ipc->fd < 0)
+        {
+            free(ipc);
+            return NULL;
+        }
+        ipc->par = thinros_bind_map(ipc->fd, ipc->size, prot, NULL);
+    }
+    else
+    {
+        ipc->fd = open(path, (readonly ? O_RDONLY : O_RDWR) | O_SYNC);
+        if (ipc->fd < 0)
+        {
+            fprintf(stderr, "%s: ", path);
+            perror(
+                "cannot open file, please check if thinros driver is installed.\n");
+            free(ipc);
+            return NULL;
+        }
+        if (!thinros_bind_geometry(ipc->fd))
+        {
+            close(ipc->fd);
+            free(ipc);
+            return NULL;
+        }
+        ipc->par = thinros_bind_map(ipc->fd, ipc->size, prot,
+            (void*)NONSECURE_PARTITION_LOC);
+    }
     if (ipc->par == MAP_FAILED)
     {
         perror("cannot bind to thinros partition (mmap failed)!\n");
@@ -32,16 +313,293 @@ struct thinros_ipc* thinros_bind(void)
         free(ipc);
         return NULL;
     }
+    thinros_bind_pages(ipc, cfg->flags);
+    thinros_bind_prefault(ipc, cfg->flags);
+
+    /* give the process that created the shared memory time to lay it out */
+    for (ms = 0; (cfg->flags & THINROS_BIND_SHM) && !created
+         && __atomic_load_n(&ipc->par->status, __ATOMIC_ACQUIRE)
+                == PARTITION_UNINITIALIZED
+         && ms < n_shm_wait_ms;
+         ms++)
+    {
+        thinros_sleep_ms(1);
+    }
+
+    /* reattach to a running partition only if this build can read it */
+    if (ipc->par->status != PARTITION_UNINITIALIZED
+        && !topic_partition_compatible(ipc->par))
+    {
+        fprintf(stderr,
+            "thinros partition laid out by an incompatible build "
+            "(version %016lx, expected %016lx)\n",
+            (unsigned long)ipc->par->version,
+            (unsigned long)topic_partition_version());
+        munmap(ipc->par, ipc->size);
+        close(ipc->fd);
+        free(ipc);
+        return NULL;
+    }
     return ipc;
 }
 
+struct thinros_ipc* thinros_bind(void)
+{
+    struct thinros_bind_config_t cfg = {
+        .flags     = thinros_bind_parse(getenv("THINROS_BIND")),
+        .partition = getenv("THINROS_PARTITION") != NULL
+                       ? (unsigned int)atoi(getenv("THINROS_PARTITION"))
+                       : 0,
+    };
+    return thinros_bind_config(&cfg);
+}
+
 void thinros_unbind(struct thinros_ipc* ipc)
 {
     if (ipc != NULL)
     {
+        munmap(ipc->par, ipc->size);
+        if (ipc->pipe[0] >= 0)
+        {
+            close(ipc->pipe[0]);
+            close(ipc->pipe[1]);
+        }
         close(ipc->fd);
         free(ipc);
     }
 }
 
+ssize_t thinros_splice(
+    struct thinros_ipc* ipc, const void* addr, size_t len, int fd_out)
+{
+    loff_t  off  = (const uint8_t*)addr - (const uint8_t*)ipc->par;
+    size_t  sent = 0;
+    ssize_t in, out;
+
+    if (off < 0 || (size_t)off > ipc->size || len > ipc->size - (size_t)off)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+    if (ipc->pipe[0] < 0)
+    {
+        if (pipe2(ipc->pipe, O_CLOEXEC) != 0)
+        {
+            return -1;
+        }
+        /* fewer round trips per message, the default holds 64 KB */
+        fcntl(ipc->pipe[1], F_SETPIPE_SZ, n_splice_pipe_size);
+    }
+    while (sent < len)
+    {
+        in = splice(ipc->fd, &off, ipc->pipe[1], NULL, len - sent,
+            SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (in <= 0)
+        {
+            return sent > 0 ? (ssize_t)sent : -1;
+        }
+        while (in > 0)
+        {
+            out = splice(ipc->pipe[0], NULL, fd_out, NULL, (size_t)in,
+                SPLICE_F_MOVE | (sent + in < len ? SPLICE_F_MORE : 0));
+            if (out <= 0)
+            {
+                /* bytes of this message stay in the pipe, start afresh */
+                close(ipc->pipe[0]);
+                close(ipc->pipe[1]);
+                ipc->pipe[0] = ipc->pipe[1] = -1;
+                return -1;
+            }
+            in   -= out;
+            sent += (size_t)out;
+        }
+    }
+    return (ssize_t)sent;
+}
+
+/* mprotect the pages lying wholly in [addr, addr + size) */
+static int thinros_protect_range(uint8_t* addr, size_t size, int prot)
+{
+    size_t    page  = (size_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t)addr + page - 1) & ~(page - 1);
+    uintptr_t end   = ((uintptr_t)addr + size) & ~(page - 1);
+
+    return end > start ? mprotect((void*)start, end - start, prot) : 0;
+}
+
+int thinros_protect_topic(struct thinros_ipc* ipc, size_t uuid)
+{
+    struct topic_partition_t*     par = ipc->par;
+    struct topic_registry_item_t* topic
+        = topic_registry_query(topic_partition_registry(par), uuid);
+    size_t bytes;
+
+    if (topic == NULL)
+    {
+        return -1;
+    }
+    bytes = sizeof(struct topic_ring_t)
+          + topic->length * (sizeof(struct topic_data_t) + topic->elem_sz)
+          + PADDING_BYTES;
+    if ((topic->local_ring != INVALID_RELATIVE_ADDR
+            && thinros_protect_range(&par->topic_buffer[topic->local_ring],
+                   bytes, PROT_READ) != 0)
+        || (topic->external_ring != INVALID_RELATIVE_ADDR
+            && thinros_protect_range(&par->topic_buffer[topic->external_ring],
+                   bytes, PROT_READ) != 0))
+    {
+        perror("cannot protect the rings (mprotect)");
+        return -1;
+    }
+    return 0;
+}
+
+int thinros_bind_remove(const struct thinros_bind_config_t* cfg)
+{
+    char path[256];
+
+    thinros_bind_path(cfg, path, sizeof(path));
+    return shm_unlink(path);
+}
+
+int thinros_load_namespace(struct topic_partition_t* par,
+    const struct topic_partition_limits_t* limits, const char* path)
+{
+    struct topic_namespace_table_t* t;
+    char                            line[256];
+    size_t                          lineno = 0;
+    int                             n      = 0;
+    FILE*                           f      = fopen(path, "r");
 
+    if (f == NULL)
+    {
+        perror("cannot open the topic namespace");
+        return -1;
+    }
+
+    /* parsed aside, the partition is laid out once the whole file is good */
+    t = malloc(topic_namespace_table_size(limits->max_topics));
+    if (t == NULL)
+    {
+        perror("cannot allocate the topic namespace");
+        fclose(f);
+        return -1;
+    }
+    topic_namespace_table_init(t, limits->max_topics);
+    while (n == 0 && fgets(line, sizeof(line), f) != NULL)
+    {
+        char   name[TOPIC_NAME_SIZE + 1], extra;
+        size_t uuid, length, elem_sz;
+        char*  comment = strchr(line, '#');
+        int    fields;
+
+        lineno++;
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+        fields = sscanf(line, "%32s %zu %zu %zu %c", name, &uuid, &length,
+            &elem_sz, &extra);
+        if (fields <= 0)
+        {
+            /* blank line */
+            continue;
+        }
+        if (fields != 4 || length == 0 || length > limits->max_ring_elems
+            || elem_sz == 0 || elem_sz > MAX_MESSAGE_SIZE
+            || !topic_namespace_table_add(t, name, uuid, length, elem_sz))
+        {
+            fprintf(stderr,
+                "%s:%lu: bad or duplicate topic, expect "
+                "`<name> <uuid> <length 1-%lu> <element size 1-%lu>`\n",
+                path, lineno, limits->max_ring_elems,
+                MAX_MESSAGE_SIZE);
+            n = -1;
+        }
+    }
+
+    if (n == 0)
+    {
+        topic_partition_init_namespace(par, limits, t);
+        n = (int)t->n;
+    }
+    free(t);
+    fclose(f);
+    return n;
+}
+
+static void thinros_prefault_stack(size_t sz)
+{
+    volatile uint8_t* stack = alloca(sz);
+    size_t            page  = (size_t)sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < sz; i += page)
+    {
+        stack[i] = 0;
+    }
+}
+
+static void thinros_prefault_partition(struct topic_partition_t* par)
+{
+    volatile uint8_t* buffer = par->topic_buffer;
+    size_t            page   = (size_t)sysconf(_SC_PAGESIZE);
+    for (size_t i = 0; i < TOPIC_BUFFER_SIZE; i += page)
+    {
+        /* read only, the rings may be in use by other nodes */
+        (void)buffer[i];
+    }
+}
+
+bool thinros_exec_apply_config(
+    const struct thinros_exec_config_t* cfg, struct topic_partition_t* par)
+{
+    bool succ = true;
+
+    if (cfg->cpu_mask != 0)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (size_t cpu = 0; cpu < 64; cpu++)
+        {
+            if (cfg->cpu_mask & (1llu << cpu))
+            {
+                CPU_SET(cpu, &set);
+            }
+        }
+        if (sched_setaffinity(0, sizeof(set), &set) != 0)
+        {
+            perror("cannot pin the thread (sched_setaffinity)");
+            succ = false;
+        }
+    }
+
+    if (cfg->lock_memory)
+    {
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+        {
+            perror("cannot lock memory (mlockall)");
+            succ = false;
+        }
+    }
+
+    if (cfg->prefault_stack != 0)
+    {
+        thinros_prefault_stack(cfg->prefault_stack);
+    }
+
+    if (cfg->prefault_partition && par != NULL)
+    {
+        thinros_prefault_partition(par);
+    }
+
+    if (cfg->sched_priority != 0)
+    {
+        struct sched_param param = { .sched_priority = cfg->sched_priority };
+        if (sched_setscheduler(0, SCHED_FIFO, &param) != 0)
+        {
+            perror("cannot switch to SCHED_FIFO (sched_setscheduler)");
+            succ = false;
+        }
+    }
+
+    return succ;
+}
@@ -1,20 +1,122 @@
 #ifndef _THINROS_LINUX_H_
 #define _THINROS_LINUX_H_
 
+#include <stddef.h>
+#include <sys/types.h>
+
+struct topic_partition_limits_t;
+
 struct thinros_ipc
 {
     int fd;
     struct topic_partition_t* par;
+    size_t size;    /* bytes mapped */
+    int    pipe[2]; /* of thinros_splice(), -1 until first used */
 };
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* options of thinros_bind_config(), see THINROS_BIND */
+#define THINROS_BIND_HUGE_PAGES (1u << 0) /* map the partition with 2 MB pages */
+#define THINROS_BIND_PREFAULT   (1u << 1) /* map every page before returning */
+#define THINROS_BIND_LOCK       (1u << 2) /* keep the pages resident (mlock) */
+#define THINROS_BIND_SHM        (1u << 3) /* POSIX shared memory, no driver */
+#define THINROS_BIND_SPARSE     (1u << 4) /* map only the partition nodes use */
+#define THINROS_BIND_READONLY   (1u << 5) /* no writes, a broadcast partition */
+
+struct thinros_bind_config_t
+{
+    unsigned int flags;    /* THINROS_BIND_* */
+    const char*  shm_name;  /* THINROS_BIND_SHM, NULL: $THINROS_SHM or /thinros */
+    unsigned int partition; /* of the driver (or object name suffix), 0: first */
+};
+
+/**
+ * map the partition of the driver, or with THINROS_BIND_SHM the POSIX shared
+ * memory object `shm_name` holding the same NONSECURE_PARTITION_SIZE layout,
+ * so that nodes run on any Linux machine. the first process creates the
+ * object zeroed, i.e. PARTITION_UNINITIALIZED, and is expected to initialize
+ * it; the others wait a second for that before returning. a partition
+ * already initialized (e.g. by a process that restarted since) is attached
+ * as it is, if it was laid out by a compatible build, see
+ * topic_partition_compatible().
+ *
+ * with THINROS_BIND_HUGE_PAGES the partition is faulted in 2 MB at a time,
+ * this needs the driver loaded with `huge_pages=1` and transparent huge
+ * pages enabled (`always` or `madvise`); otherwise it is mapped with 4 KB
+ * pages.
+ *
+ * THINROS_BIND_PREFAULT takes the page faults of the whole partition in
+ * thinros_bind_config() instead of on the first message of every ring, and
+ * THINROS_BIND_LOCK keeps the pages from being reclaimed afterwards (a no-op
+ * on the driver mapping, which is never reclaimed).
+ *
+ * THINROS_BIND_SPARSE maps `par` alone, about 4 MB, rather than the whole
+ * region holding the partitions of the other worlds.
+ *
+ * THINROS_BIND_READONLY opens and maps the partition read-only, for the
+ * broadcast partition nodes read with thinros_node_broadcast(): only the
+ * master writes it. a read-only process never creates the shared memory
+ * object, it waits a second for it like for the layout.
+ *
+ * @return NULL if the driver is missing or the partition is incompatible
+ */
+struct thinros_ipc* thinros_bind_config(const struct thinros_bind_config_t* cfg);
+
+/**
+ * thinros_bind_config() with the options in the environment variable
+ * THINROS_BIND, a comma separated list of: `huge`, `prefault`, `lock`,
+ * `shm`, `sparse`, `readonly`, and the partition in THINROS_PARTITION (the
+ * driver exposes partition i > 0 as /dev/thinros<i>).
+ */
 struct thinros_ipc* thinros_bind(void);
 
 void thinros_unbind(struct thinros_ipc* ipc);
 
+/**
+ * make the rings of topic `uuid` read-only in this process, for a topic it
+ * only subscribes to: a stray write faults instead of corrupting messages.
+ * only pages wholly in the rings are protected, call it after subscribing,
+ * once the rings are allocated.
+ *
+ * @return 0, -1 if the topic is not registered or mprotect failed
+ */
+int thinros_protect_topic(struct thinros_ipc* ipc, size_t uuid);
+
+/**
+ * send [addr, addr + len) of the mapped partition, e.g. the payload of a
+ * ring slot from topic_reader_read_next(), to `fd_out` (socket, pipe or
+ * file) with splice(2): the driver, or the shared memory object, hands its
+ * pages over without a copy through user space. the bytes are taken when
+ * fd_out consumes them, a slot the writer reuses meanwhile goes out
+ * overwritten: splice from rings long enough for the sender to keep up.
+ *
+ * @return bytes sent, -1 on error (errno)
+ */
+ssize_t thinros_splice(
+    struct thinros_ipc* ipc, const void* addr, size_t len, int fd_out);
+
+/**
+ * remove the shared memory object of a THINROS_BIND_SHM config, processes
+ * still bound keep their mapping. the next thinros_bind() starts afresh.
+ *
+ * @return 0, -1 if there is no such object
+ */
+int thinros_bind_remove(const struct thinros_bind_config_t* cfg);
+
+/**
+ * initialize `par` with `limits`, sharing the topic namespace read from a
+ * text file, one topic per line: `<name> <uuid> <length> <element size>`,
+ * '#' starts a comment. in place of topic_partition_init_limits(), so that
+ * no process attaches before the namespace is there.
+ *
+ * @return number of topics, -1 on error (the partition is left as it was)
+ */
+int thinros_load_namespace(struct topic_partition_t* par,
+    const struct topic_partition_limits_t* limits, const char* path);
+
 #ifdef __cplusplus
 }
 #endif
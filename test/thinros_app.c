@@ -26,6 +26,10 @@ msg_lidar_t lidar_msg;
 
 static struct timespec t_start, t_last, t_now;
 static size_t count = 0;
+static size_t total = 0;
+
+struct thinros_timer_t control_timer;
+struct thinros_timer_t report_timer;
 
 void on_lidar_frame(void* data)
 {
@@ -42,6 +46,27 @@ static time_t timespec_diff(struct timespec *t1, struct timespec * t0)
     return v;
 }
 
+void on_control_timer(void* arg)
+{
+    steer_control.value++;
+    thinros_publish(&steer_pub, &steer_control, sizeof(msg_steer_t));
+
+    throttle_control.value++;
+    thinros_publish(&throttle_pub, &throttle_control, sizeof(msg_steer_t));
+}
+
+void on_report_timer(void* arg)
+{
+    clock_gettime(CLOCK_REALTIME, &t_now);
+    total += count;
+    printf("[%.3f] duration %.3f received %lu (%lu KB/s)\n",
+        timespec_diff(&t_now, &t_start) / 1000000000.0,
+        timespec_diff(&t_now, &t_last) / 1000000000.0,
+        total, count * sizeof(msg_lidar_t) / 1024);
+    t_last = t_now;
+    count = 0;
+}
+
 int main(int argc, char** argv)
 {
     struct thinros_ipc* ipc;
@@ -51,7 +76,18 @@ int main(int argc, char** argv)
         return (EXIT_FAILURE);
     }
     /* no need to initialize the partition, if the partition is created by certikos first */
-    if (ipc->par->status == PARTITION_UNINITIALIZED)
+    if (ipc->par->status == PARTITION_UNINITIALIZED
+        && getenv("THINROS_NAMESPACE") != NULL)
+    {
+        /* share a namespace from a file instead of the compiled-in one */
+        struct topic_partition_limits_t limits = TOPIC_PARTITION_DEFAULT_LIMITS;
+        if (thinros_load_namespace(ipc->par, &limits,
+                getenv("THINROS_NAMESPACE")) < 0)
+        {
+            return (EXIT_FAILURE);
+        }
+    }
+    else if (ipc->par->status == PARTITION_UNINITIALIZED)
     {
         topic_partition_init(ipc->par);
     }
@@ -68,31 +104,13 @@ int main(int argc, char** argv)
 
     clock_gettime(CLOCK_REALTIME, &t_last);
     t_start = t_last;
-    size_t total = 0;
-    while (true)
-    {
-        steer_control.value++;
-        thinros_publish(&steer_pub, &steer_control, sizeof(msg_steer_t));
-
-        throttle_control.value++;
-        thinros_publish(&throttle_pub, &throttle_control, sizeof(msg_steer_t));
-
-        thinros_spin(&this_node, SPIN_ONCE, NULL, 0llu);
+    thinros_timer_periodic(&control_timer, &this_node, 20000000llu,
+        on_control_timer, NULL);
+    thinros_timer_periodic(&report_timer, &this_node, 1000000000llu,
+        on_report_timer, NULL);
 
-        clock_gettime(CLOCK_REALTIME, &t_now);
-        if (t_now.tv_sec - t_last.tv_sec >= 1)
-        {
-            total += count;
-            printf("[%.3f] duration %.3f received %lu (%lu KB/s)\n",
-                timespec_diff(&t_now, &t_start) / 1000000000.0,
-                timespec_diff(&t_now, &t_last) / 1000000000.0,
-                total, count * sizeof(msg_lidar_t) / 1024);
-            t_last = t_now;
-            count = 0;
-        }
-
-        usleep(20000);
-    }
+    /* poll the subscriptions every 1 ms between timers */
+    thinros_spin(&this_node, SPIN_SLEEP, NULL, 1000000llu);
 
     thinros_unbind(ipc);
     return EXIT_SUCCESS;
@@ -1,11 +1,8 @@
 #include <unistd.h>
 #include <fcntl.h>
-#include <string>
-#include "lib/thinros_core.h"
+#include "lib/thinros.hpp"
 #include "lib/thinros_linux.h"
 
-using namespace std;
-
 struct node_handle_t this_node;
 
 struct publisher_t lidar_scan;
@@ -13,6 +10,8 @@ struct publisher_t lidar_scan;
 struct subscriber_t steer;
 struct subscriber_t throttle;
 
+struct thinros_timer_t scan_timer;
+
 msg_steer_t steer_control;
 msg_throttle_t throttle_control;
 msg_lidar_t lidar_msg;
@@ -35,6 +34,15 @@ void on_thr_control(void* data)
     current_throttle = msg->value;
 }
 
+void on_scan_timer(void* arg)
+{
+    static size_t total = 0;
+    thinros::publish<"fwd_scan">(lidar_scan, lidar_msg);
+    total ++;
+    printf("[%lu] steer: %f (count=%lu), throttle: %f (count=%lu)\n",
+           total, current_steer, steer_count, current_throttle, throttle_count);
+}
+
 int main(int argc, char** argv)
 {
     struct thinros_ipc* ipc;
@@ -54,24 +62,17 @@ int main(int argc, char** argv)
     topic_nonsecure_partition_init(ipc->par);
 
     /* create node */
-    thinros_node(&this_node, ipc->par, (char *) (string{"proxy"}).c_str());
+    thinros_node(&this_node, ipc->par, "proxy");
 
     /* create publishers and subscribers */
-    /* topic name see @file://./lib/thinros_cfg.c */
-    thinros_advertise(&lidar_scan, &this_node, (char *) (string{"fwd_scan"}).c_str());
-    thinros_subscribe(&steer, &this_node, (char *) (string{"drv_steer"}).c_str(), on_steer_control);
-    thinros_subscribe(&throttle, &this_node, (char *) (string{"drv_throttle"}).c_str(), on_thr_control);
+    /* topics are resolved at compile time, see THINROS_TOPICS in lib/thinros_cfg.h */
+    thinros::advertise<"fwd_scan", msg_lidar_t>(lidar_scan, this_node);
+    thinros::subscribe<"drv_steer", msg_steer_t>(steer, this_node, on_steer_control);
+    thinros::subscribe<"drv_throttle", msg_throttle_t>(throttle, this_node, on_thr_control);
 
-    size_t total = 0;
-    while (true)
-    {
-        thinros_spin(&this_node, SPIN_ONCE, NULL, 0llu);
-        thinros_publish(&lidar_scan, &lidar_msg, sizeof(msg_lidar_t));
-        total ++;
-        printf("[%lu] steer: %f (count=%lu), throttle: %f (count=%lu)\n",
-               total, current_steer, steer_count, current_throttle, throttle_count);
-        usleep(20000);
-    }
+    thinros_timer_periodic(&scan_timer, &this_node, 20000000llu, on_scan_timer,
+        nullptr);
+    thinros_spin(&this_node, SPIN_SLEEP, NULL, 1000000llu);
 
     thinros_unbind(ipc);
     return EXIT_SUCCESS;
@@ -0,0 +1,210 @@
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "lib/thinros_core.h"
+#include "test/thinros_bench_common.h"
+
+/*
+ * cross-partition topics replicated into an external ring per subscribing
+ * partition against one broadcast ring all of them read
+ * (thinros_master_broadcast): a node of the first partition publishes every
+ * topic and a node of each of the others subscribes to all of them, with 2
+ * to 4 partitions. reports the copies and the bytes copied per message, the
+ * ring memory, the time of a round switching to every partition once and
+ * the time the subscribers take to receive the round. the broadcast
+ * partition is mapped a second time read-only for the nodes, as they would
+ * bind it. built with MAX_TOPICS=256 and its own namespace.
+ *
+ * usage: thinros_bench_broadcast [rounds]
+ */
+
+#define TOPICS   (32lu)
+#define RING_LEN (32lu)
+#define ELEM_SZ  (512lu) /* MAX_MESSAGE_SIZE, the subscribers receive */
+#define MAX_PART (4lu)
+
+struct topic_namespace_t topic_namespace;
+struct topic_layout_t    topic_layout; /* no static rings */
+
+static struct thinros_master_t    master;
+static uint64_t                   arena[128 * _1k];
+static struct node_handle_t       nodes[MAX_PART];
+static struct publisher_t         publishers[TOPICS];
+static struct subscriber_t        subscribers[MAX_PART][TOPICS];
+static struct thinros_histogram_t rounds, receives;
+static uint8_t                    message[ELEM_SZ];
+static size_t                     received;
+
+static void
+on_message(void* msg)
+{
+    (void)msg;
+    received++;
+}
+
+/* external or local rings of `n` partitions */
+static size_t
+ring_count(struct topic_partition_t* par, size_t n, bool external)
+{
+    struct topic_partition_usage_t usage;
+    size_t                         i, rings = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        topic_partition_usage(&par[i], &usage);
+        rings += external ? usage.external_rings : usage.local_rings;
+    }
+    return rings;
+}
+
+/* bytes allocated in `n` partitions */
+static size_t
+in_use(struct topic_partition_t* par, size_t n)
+{
+    struct topic_partition_usage_t usage;
+    size_t                         i, bytes = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        topic_partition_usage(&par[i], &usage);
+        bytes += usage.in_use;
+    }
+    return bytes;
+}
+
+static void
+run(size_t n_part, bool broadcast, size_t n)
+{
+    size_t ring_sz = sizeof(struct topic_ring_t)
+                   + (sizeof(struct topic_data_t) + ELEM_SZ) * RING_LEN;
+    struct topic_partition_t *parts, *bc = NULL, *bc_ro = NULL;
+    size_t                    rings, bytes, copied = 0, i, j, k;
+    uint64_t                  t0;
+    int                       fd = -1;
+
+    parts = mmap(NULL, n_part * sizeof(struct topic_partition_t),
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT(parts != MAP_FAILED);
+    thinros_master_init(&master, n_part, arena, sizeof(arena));
+    for (i = 0; i < n_part; i++)
+    {
+        topic_partition_init(&parts[i]);
+        thinros_master_add(&master, &parts[i]);
+    }
+    if (broadcast)
+    {
+        /* the master writes, the nodes read a read-only view */
+        fd = memfd_create("thinros_bench_broadcast", 0);
+        ASSERT(fd >= 0);
+        ASSERT(ftruncate(fd, sizeof(struct topic_partition_t)) == 0);
+        bc = mmap(NULL, sizeof(struct topic_partition_t),
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        bc_ro = mmap(NULL, sizeof(struct topic_partition_t), PROT_READ,
+            MAP_SHARED, fd, 0);
+        ASSERT(bc != MAP_FAILED && bc_ro != MAP_FAILED);
+        topic_partition_init(bc);
+        thinros_master_broadcast(&master, bc);
+    }
+    thinros_master_build(&master);
+
+    thinros_node(&nodes[0], &parts[0], "pub");
+    for (i = 1; i < n_part; i++)
+    {
+        thinros_node(&nodes[i], &parts[i], "sub");
+        if (broadcast)
+        {
+            thinros_node_broadcast(&nodes[i], bc_ro);
+        }
+    }
+    for (j = 0; j < TOPICS; j++)
+    {
+        thinros_advertise_uuid(&publishers[j], &nodes[0], j + 1);
+        for (i = 1; i < n_part; i++)
+        {
+            thinros_subscribe_uuid(&subscribers[i][j], &nodes[i], j + 1,
+                on_message, PRIO_NORMAL, 0);
+        }
+    }
+    thinros_master_update(&master);
+
+    thinros_histogram_reset(&rounds);
+    thinros_histogram_reset(&receives);
+    received = 0;
+    for (k = 0; k < n; k++)
+    {
+        for (j = 0; j < TOPICS; j++)
+        {
+            thinros_publish(&publishers[j], message, sizeof(message));
+        }
+        t0 = thinros_now();
+        for (i = 0; i < n_part; i++)
+        {
+            thinros_master_switch_to(&master, i);
+        }
+        thinros_histogram_record(&rounds, thinros_now() - t0);
+        t0 = thinros_now();
+        for (i = 1; i < n_part; i++)
+        {
+            thinros_spin(&nodes[i], SPIN_ONCE, NULL, 0);
+        }
+        thinros_histogram_record(&receives, thinros_now() - t0);
+    }
+
+    bytes = in_use(parts, n_part);
+    if (broadcast)
+    {
+        copied = master.broadcast.stats.copied;
+        rings  = ring_count(bc, 1, false);
+        bytes += in_use(bc, 1);
+    }
+    else
+    {
+        for (i = 0; i < n_part; i++)
+        {
+            copied += master.partitions[i].stats.copied;
+        }
+        rings = ring_count(parts, n_part, true);
+    }
+    printf("%lu partitions, %-9s: %.2f copies (%6.0f bytes) per message, "
+           "%3lu rings of %lu KB copied into, %5lu KB in use, "
+           "received %lu of %lu\n",
+        n_part, broadcast ? "broadcast" : "external",
+        (double)copied / (n * TOPICS),
+        (double)copied * ELEM_SZ / (n * TOPICS), rings, ring_sz / _1k,
+        bytes / _1k, received, n * TOPICS * (n_part - 1));
+    printf("    round (ns) ");
+    thinros_histogram_print(&rounds);
+    printf("    receive (ns) ");
+    thinros_histogram_print(&receives);
+
+    if (broadcast)
+    {
+        munmap(bc_ro, sizeof(struct topic_partition_t));
+        munmap(bc, sizeof(struct topic_partition_t));
+        close(fd);
+    }
+    munmap(parts, n_part * sizeof(struct topic_partition_t));
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 0) : 10000, p;
+
+    bench_namespace("bench/broadcast_%02lu", TOPICS, RING_LEN, ELEM_SZ);
+    printf("%lu topics of %lu x %lu bytes, %lu rounds of a message per "
+           "topic\n",
+        TOPICS, RING_LEN, ELEM_SZ, n);
+    for (p = 2; p <= MAX_PART; p++)
+    {
+        run(p, false, n);
+        run(p, true, n);
+    }
+    return 0;
+}
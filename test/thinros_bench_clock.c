@@ -0,0 +1,62 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "lib/thinros_core.h"
+
+/*
+ * per-call cost of thinros_now() against time_ns() (clock_gettime), and the
+ * drift between the two after a short run.
+ *
+ * usage: thinros_bench_clock [iterations]
+ */
+
+static const char* const source_names[] = {
+    [CLOCK_SOURCE_UNCALIBRATED] = "uncalibrated",
+    [CLOCK_SOURCE_CALIBRATING]  = "calibrating",
+    [CLOCK_SOURCE_COUNTER]      = "cycle counter",
+    [CLOCK_SOURCE_FALLBACK]     = "clock_gettime",
+};
+
+int
+main(int argc, char** argv)
+{
+    size_t            iterations = 10000000;
+    volatile uint64_t sink       = 0;
+    uint64_t          t0, t1, prev;
+    size_t            i, backwards = 0;
+
+    if (argc > 1)
+    {
+        iterations = strtoul(argv[1], NULL, 0);
+    }
+
+    thinros_clock_init();
+    printf("clock source: %s (mult 0x%lx)\n",
+        source_names[thinros_clock.source], thinros_clock.mult);
+
+    t0 = time_ns();
+    for (i = 0; i < iterations; i++)
+    {
+        sink += time_ns();
+    }
+    t1 = time_ns();
+    printf("time_ns()     %6.2f ns/call\n", (double)(t1 - t0) / iterations);
+
+    t0   = time_ns();
+    prev = thinros_now();
+    for (i = 0; i < iterations; i++)
+    {
+        uint64_t now = thinros_now();
+        backwards   += now < prev;
+        prev         = now;
+    }
+    t1 = time_ns();
+    printf("thinros_now() %6.2f ns/call (%lu backward steps)\n",
+        (double)(t1 - t0) / iterations, backwards);
+
+    printf("drift after run: %ld ns\n", (long)(thinros_now() - time_ns()));
+    (void)sink;
+    return 0;
+}
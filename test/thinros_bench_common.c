@@ -0,0 +1,23 @@
+#include <stddef.h>
+#include <stdio.h>
+
+#include "lib/thinros_core.h"
+#include "test/thinros_bench_common.h"
+
+void
+bench_namespace(const char* format, size_t n, size_t length, size_t elem_sz)
+{
+    size_t i;
+
+    ASSERT(n <= MAX_TOPICS);
+    topic_namespace.n = n;
+    for (i = 0; i < n; i++)
+    {
+        struct topic_namespace_item_t* item = &topic_namespace.topic[i];
+        snprintf(item->name, TOPIC_NAME_SIZE, format, i);
+        item->uuid    = i + 1;
+        item->length  = length;
+        item->elem_sz = elem_sz;
+    }
+    topic_namespace_index_build();
+}
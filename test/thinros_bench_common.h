@@ -0,0 +1,14 @@
+#ifndef _THINROS_BENCH_COMMON_H_
+#define _THINROS_BENCH_COMMON_H_
+
+#include <stddef.h>
+
+/**
+ * fill the compiled-in namespace of a benchmark with `n` topics of rings of
+ * `length` x `elem_sz` bytes, uuids 1 to n, named by `format` with the index
+ * of the topic (e.g. "bench/topic_%03lu"), and index it
+ */
+void bench_namespace(const char* format, size_t n, size_t length,
+    size_t elem_sz);
+
+#endif
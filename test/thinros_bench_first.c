@@ -0,0 +1,107 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "lib/thinros_core.h"
+#include "test/thinros_bench_common.h"
+
+/*
+ * latency of the first messages published to fresh rings, whose slots have
+ * never been touched, against a second lap over the same slots. the first
+ * lap pays a page fault per 4 KB slot unless the partition was prefaulted
+ * and locked the way THINROS_BIND=prefault,lock does it. the partition is
+ * shared anonymous memory standing in for the driver mapping. built with
+ * MAX_TOPICS=256 and its own synthetic namespace.
+ */
+
+#define TOPICS   (64lu)
+#define RING_LEN (8lu)
+#define ELEM_SZ  (4096lu)
+
+struct topic_namespace_t topic_namespace;
+struct topic_layout_t    topic_layout; /* no static rings */
+
+static struct node_handle_t bench_node;
+static struct publisher_t   publishers[TOPICS];
+static uint8_t              message[ELEM_SZ];
+
+/* one message to every slot of every ring, mean and worst in ns */
+static void
+lap(double* mean, uint64_t* worst)
+{
+    uint64_t t0, t1, total = 0;
+    size_t   i, j;
+
+    *worst = 0;
+    for (j = 0; j < RING_LEN; j++)
+    {
+        for (i = 0; i < TOPICS; i++)
+        {
+            message[0] = (uint8_t)j;
+            t0 = thinros_now();
+            thinros_publish(&publishers[i], message, sizeof(message));
+            t1 = thinros_now();
+            total += t1 - t0;
+            *worst = t1 - t0 > *worst ? t1 - t0 : *worst;
+        }
+    }
+    *mean = (double)total / (TOPICS * RING_LEN);
+}
+
+static void
+run(const char* label, bool prefault)
+{
+    struct topic_partition_limits_t limits = TOPIC_PARTITION_DEFAULT_LIMITS;
+    struct topic_partition_t* par;
+    volatile uint8_t*         base;
+    size_t   page = (size_t)sysconf(_SC_PAGESIZE), i;
+    double   first_mean, second_mean;
+    uint64_t first_worst, second_worst;
+
+    par = mmap(NULL, NONSECURE_PARTITION_SIZE, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    ASSERT(par != MAP_FAILED);
+    if (prefault)
+    {
+        /* as thinros_bind_prefault() */
+        base = (volatile uint8_t*)par;
+        for (i = 0; i < NONSECURE_PARTITION_SIZE; i += page)
+        {
+            (void)base[i];
+        }
+        if (mlock(par, NONSECURE_PARTITION_SIZE) != 0)
+        {
+            perror("mlock");
+        }
+    }
+
+    limits.max_topics = TOPICS;
+    topic_partition_init_limits(par, &limits);
+    thinros_node(&bench_node, par, "bench");
+    for (i = 0; i < TOPICS; i++)
+    {
+        thinros_advertise_uuid(&publishers[i], &bench_node, i + 1);
+    }
+
+    lap(&first_mean, &first_worst);
+    lap(&second_mean, &second_worst);
+    printf("%-14s first lap %7.1f ns/msg (worst %6lu ns), "
+           "second lap %7.1f ns/msg (worst %6lu ns)\n",
+        label, first_mean, first_worst, second_mean, second_worst);
+
+    munlock(par, NONSECURE_PARTITION_SIZE);
+    munmap(par, NONSECURE_PARTITION_SIZE);
+}
+
+int
+main(int argc, char** argv)
+{
+    bench_namespace("bench/first_%02lu", TOPICS, RING_LEN, ELEM_SZ);
+    run("lazy", false);
+    run("prefault,lock", true);
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "lib/thinros_core.h"
+#include "lib/thinros_linux.h"
+
+/*
+ * periodic timer jitter of a spinning node, with the default scheduling and
+ * with the thread pinned, SCHED_FIFO and locked memory.
+ *
+ * usage: thinros_bench_jitter [cpu] [sched priority] [samples]
+ */
+
+#define PERIOD_NS (1000000llu)
+
+static struct topic_partition_t bench_part;
+static struct node_handle_t     bench_node;
+static struct thinros_timer_t   bench_timer;
+
+static uint64_t* samples;
+static size_t    n_samples, max_samples;
+
+static void
+on_tick(void* arg)
+{
+    struct thinros_timer_t* t   = arg;
+    uint64_t                now = thinros_now();
+    /* expires has been advanced to the next period already */
+    samples[n_samples++] = now - (t->expires - t->period);
+    if (n_samples == max_samples)
+    {
+        atomic_store(&bench_node.running, false);
+    }
+}
+
+static int
+cmp_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void
+run(const char* label, struct thinros_exec_config_t* cfg)
+{
+    uint64_t sum = 0;
+
+    thinros_node(&bench_node, &bench_part, "jitter");
+    if (cfg != NULL)
+    {
+        thinros_node_exec(&bench_node, cfg);
+    }
+    n_samples = 0;
+    thinros_timer_periodic(
+        &bench_timer, &bench_node, PERIOD_NS, on_tick, &bench_timer);
+    thinros_spin(&bench_node, SPIN_SLEEP, NULL, 0);
+    thinros_timer_cancel(&bench_timer);
+
+    qsort(samples, n_samples, sizeof(uint64_t), cmp_u64);
+    for (size_t i = 0; i < n_samples; i++)
+    {
+        sum += samples[i];
+    }
+    printf("%-10s samples %6lu min %8lu avg %8lu p50 %8lu p99 %8lu "
+           "max %8lu (ns, overruns %lu)\n",
+        label, n_samples, samples[0], sum / n_samples,
+        samples[n_samples / 2], samples[n_samples * 99 / 100],
+        samples[n_samples - 1], bench_timer.overruns);
+}
+
+int
+main(int argc, char** argv)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int  cpu  = argc > 1 ? atoi(argv[1]) : (int)(cpus - 1);
+    int  prio = argc > 2 ? atoi(argv[2]) : 80;
+
+    max_samples = argc > 3 ? strtoul(argv[3], NULL, 0) : 5000;
+    samples     = malloc(max_samples * sizeof(uint64_t));
+
+    topic_partition_init(&bench_part);
+
+    printf("period %llu ns, pinned run on cpu %d with SCHED_FIFO %d\n",
+        PERIOD_NS, cpu, prio);
+    run("default", NULL);
+
+    struct thinros_exec_config_t cfg = {
+        .cpu_mask       = 1llu << cpu,
+        .sched_priority = prio,
+        .lock_memory    = true,
+        .prefault_stack = 256 * _1k,
+    };
+    run("pinned", &cfg);
+
+    free(samples);
+    return 0;
+}
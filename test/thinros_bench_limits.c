@@ -0,0 +1,137 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib/thinros_core.h"
+#include "test/thinros_bench_common.h"
+
+/*
+ * per-message cost of publish, delivery and replication as the partition
+ * limits grow. every partition registers half of its topic capacity, one
+ * `hot` topic with the deepest ring allowed carries the traffic. built with
+ * MAX_TOPICS=4096 and its own synthetic namespace.
+ */
+
+#define MESSAGES (200000lu)
+#define BATCH    (16lu)
+#define HOT_UUID (1lu)
+
+struct topic_namespace_t topic_namespace;
+struct topic_layout_t    topic_layout; /* no static rings */
+
+struct bench_limits_t
+{
+    size_t max_topics;
+    size_t max_ring_elems;
+};
+
+static const struct bench_limits_t configs[] = {
+    { 8, 16 },
+    { 64, 256 },
+    { 512, 4096 },
+    { 4096, 16384 },
+};
+
+static struct topic_partition_t part_a, part_b;
+static struct node_handle_t     node_a, node_b;
+static struct publisher_t       hot_pub, cold_pub;
+static struct subscriber_t      hot_sub_a, hot_sub_b;
+static struct thinros_master_t  master;
+static uint64_t                 master_arena[64 * _1k];
+static size_t                   received;
+
+static void
+on_message(void* data)
+{
+    (void)data;
+    received++;
+}
+
+static void
+setup(const struct bench_limits_t* cfg)
+{
+    struct topic_partition_limits_t limits = {
+        .max_topics     = cfg->max_topics,
+        .max_ring_elems = cfg->max_ring_elems,
+    };
+    size_t i;
+
+    bench_namespace("robot/topic_%04lu", cfg->max_topics, 4, 8);
+    /* the hot topic with the deepest ring allowed */
+    topic_namespace.topic[HOT_UUID - 1].length = cfg->max_ring_elems;
+    topic_namespace_index_build();
+    topic_partition_init_limits(&part_a, &limits);
+    topic_partition_init_limits(&part_b, &limits);
+    thinros_node(&node_a, &part_a, "a");
+    thinros_node(&node_b, &part_b, "b");
+
+    /* fill half of each registry with idle topics */
+    for (i = 1; i < cfg->max_topics / 2; i++)
+    {
+        thinros_advertise_uuid(&cold_pub, &node_a, i + 1);
+        thinros_advertise_uuid(&cold_pub, &node_b, i + 1);
+    }
+    thinros_advertise_uuid(&hot_pub, &node_a, HOT_UUID);
+    thinros_subscribe_uuid(&hot_sub_a, &node_a, HOT_UUID, on_message,
+        PRIO_NORMAL, NO_DEADLINE);
+    thinros_subscribe_uuid(&hot_sub_b, &node_b, HOT_UUID, on_message,
+        PRIO_NORMAL, NO_DEADLINE);
+
+    thinros_master_init(&master, 2, master_arena, sizeof(master_arena));
+    thinros_master_add(&master, &part_a);
+    thinros_master_add(&master, &part_b);
+    thinros_master_build(&master);
+}
+
+static void
+run(const struct bench_limits_t* cfg)
+{
+    uint64_t publish = 0, deliver = 0, replicate = 0, t0, t1, t2, t3;
+    uint64_t message = 0;
+    size_t   i, j;
+
+    struct topic_partition_usage_t usage;
+
+    setup(cfg);
+    received = 0;
+    for (i = 0; i < MESSAGES / BATCH; i++)
+    {
+        t0 = thinros_now();
+        for (j = 0; j < BATCH; j++)
+        {
+            message++;
+            thinros_publish(&hot_pub, &message, sizeof(message));
+        }
+        t1 = thinros_now();
+        thinros_spin(&node_a, SPIN_ONCE, NULL, 0);
+        t2 = thinros_now();
+        thinros_master_switch_to(&master, 1);
+        thinros_spin(&node_b, SPIN_ONCE, NULL, 0);
+        t3 = thinros_now();
+
+        publish   += t1 - t0;
+        deliver   += t2 - t1;
+        replicate += t3 - t2;
+    }
+    ASSERT(received == 2 * MESSAGES);
+    topic_partition_usage(&part_a, &usage);
+
+    printf("%5lu topics, ring <= %5lu: publish %6.1f deliver %6.1f "
+           "replicate+deliver %6.1f ns/msg (buffer used %lu KiB)\n",
+        cfg->max_topics, cfg->max_ring_elems, (double)publish / MESSAGES,
+        (double)deliver / MESSAGES, (double)replicate / MESSAGES,
+        (usage.reserved + usage.in_use) / _1k);
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t i;
+    for (i = 0; i < sizeof(configs) / sizeof(configs[0]); i++)
+    {
+        run(&configs[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "lib/thinros_core.h"
+#include "test/thinros_bench_common.h"
+
+/*
+ * publish latency to random topics spread over a whole non-secure partition
+ * (NONSECURE_PARTITION_SIZE, as many partitions as fit), mapped with 4 KB
+ * pages and with 2 MB pages. the mappings are anonymous memory standing in
+ * for the driver's, with transparent huge pages (`madvise` or `always`)
+ * providing the 2 MB pages. built with MAX_TOPICS=1024 and its own synthetic
+ * namespace.
+ *
+ * usage: thinros_bench_pages [publishes]
+ */
+
+#define TOPICS    (256lu)
+#define RING_LEN  (128lu)
+#define ELEM_SZ   (64lu)
+#define HUGE_SIZE (2lu * _1m)
+
+struct topic_namespace_t topic_namespace;
+struct topic_layout_t    topic_layout; /* no static rings */
+
+static struct node_handle_t bench_node;
+static struct publisher_t*  publishers;
+
+/* anonymous memory bytes backed by huge pages, from smaps_rollup */
+static size_t
+huge_bytes(void)
+{
+    char   line[128];
+    size_t kb = 0;
+    FILE*  f  = fopen("/proc/self/smaps_rollup", "r");
+    if (f == NULL)
+    {
+        return 0;
+    }
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        if (sscanf(line, "AnonHugePages: %zu kB", &kb) == 1)
+        {
+            break;
+        }
+    }
+    fclose(f);
+    return kb * _1k;
+}
+
+static void
+run(const char* label, int advice, size_t publishes)
+{
+    struct topic_partition_limits_t limits = TOPIC_PARTITION_DEFAULT_LIMITS;
+    size_t   n_parts = NONSECURE_PARTITION_SIZE / sizeof(struct topic_partition_t);
+    size_t   n_pubs  = n_parts * TOPICS, i, j;
+    uint64_t rng     = 0x9e3779b97f4a7c15llu, t0, t1, message[ELEM_SZ / 8];
+    uint8_t* raw;
+    struct topic_partition_t* parts;
+
+    /* 2 MB aligned, so that every huge page lies in the partition */
+    raw = mmap(NULL, NONSECURE_PARTITION_SIZE + HUGE_SIZE,
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT(raw != MAP_FAILED);
+    parts = (struct topic_partition_t*)(((uintptr_t)raw + HUGE_SIZE - 1)
+                                        & ~(HUGE_SIZE - 1));
+    if (madvise(parts, NONSECURE_PARTITION_SIZE, advice) != 0)
+    {
+        perror("madvise");
+    }
+
+    limits.max_topics = TOPICS;
+    for (i = 0; i < n_parts; i++)
+    {
+        topic_partition_init_limits(&parts[i], &limits);
+        thinros_node(&bench_node, &parts[i], "bench");
+        for (j = 0; j < TOPICS; j++)
+        {
+            thinros_advertise_uuid(
+                &publishers[i * TOPICS + j], &bench_node, j + 1);
+        }
+    }
+    memset(message, 0, sizeof(message));
+    /* touch every ring once, faults are not part of the measurement */
+    for (i = 0; i < n_pubs; i++)
+    {
+        thinros_publish(&publishers[i], message, sizeof(message));
+    }
+
+    t0 = thinros_now();
+    for (i = 0; i < publishes; i++)
+    {
+        rng ^= rng << 13;
+        rng ^= rng >> 7;
+        rng ^= rng << 17;
+        message[0] = i;
+        thinros_publish(&publishers[rng % n_pubs], message, sizeof(message));
+    }
+    t1 = thinros_now();
+
+    printf("%-6s %2lu partitions x %lu topics: publish %6.1f ns/msg "
+           "(%lu MiB in huge pages)\n",
+        label, n_parts, TOPICS, (double)(t1 - t0) / publishes,
+        huge_bytes() / _1m);
+    munmap(raw, NONSECURE_PARTITION_SIZE + HUGE_SIZE);
+}
+
+int
+main(int argc, char** argv)
+{
+    size_t publishes = argc > 1 ? strtoul(argv[1], NULL, 0) : 4000000;
+    size_t n_parts = NONSECURE_PARTITION_SIZE / sizeof(struct topic_partition_t);
+
+    publishers = calloc(n_parts * TOPICS, sizeof(struct publisher_t));
+    bench_namespace("bench/topic_%03lu", TOPICS, RING_LEN, ELEM_SZ);
+    run("4 KB", MADV_NOHUGEPAGE, publishes);
+    run("2 MB", MADV_HUGEPAGE, publishes);
+    free(publishers);
+    return 0;
+}
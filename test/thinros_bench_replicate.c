@@ -0,0 +1,113 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "lib/thinros_core.h"
+#include "test/thinros_bench_common.h"
+
+/*
+ * time of thinros_master_switch_to() with a node of one partition
+ * publishing topics a node of the other subscribes to: a few busy topics
+ * among idle ones, and bursts on every topic that the switch copies as runs,
+ * without and with a budget (thinros_master_budget) bounding the copies of
+ * all topics but the first, a PRIO_CRITICAL control topic. the partitions
+ * are anonymous memory. built with MAX_TOPICS=256 and its own synthetic
+ * namespace.
+ *
+ * usage: thinros_bench_replicate [switches]
+ */
+
+#define TOPICS   (128lu)
+#define RING_LEN (32lu)
+#define ELEM_SZ  (256lu)
+
+struct topic_namespace_t topic_namespace;
+struct topic_layout_t    topic_layout; /* no static rings */
+
+static struct thinros_master_t    master;
+static uint64_t                   arena[64 * _1k];
+static struct node_handle_t       pub_node, sub_node;
+static struct publisher_t         publishers[TOPICS];
+static struct subscriber_t        subscribers[TOPICS];
+static struct thinros_histogram_t switches;
+static uint8_t                    message[ELEM_SZ];
+
+static void
+on_message(void* msg)
+{
+    (void)msg;
+}
+
+/* every switch, `burst` messages on each of the first `busy` topics */
+static void
+run(const char* label, size_t busy, size_t burst, size_t n)
+{
+    struct thinros_replication_stats_t* stats = &master.partitions[1].stats;
+    uint64_t t0;
+    size_t   i, j, k;
+
+    thinros_histogram_reset(&switches);
+    thinros_master_stats_reset(&master, 1);
+    for (i = 0; i < n; i++)
+    {
+        for (j = 0; j < busy; j++)
+        {
+            for (k = 0; k < burst; k++)
+            {
+                thinros_publish(&publishers[j], message, sizeof(message));
+            }
+        }
+        t0 = thinros_now();
+        thinros_master_switch_to(&master, 1);
+        thinros_histogram_record(&switches, thinros_now() - t0);
+    }
+    printf("%-28s copied %7lu deferred %7lu dropped %7lu, switch (ns) ",
+        label, (size_t)stats->copied, (size_t)stats->deferred,
+        (size_t)stats->dropped);
+    thinros_histogram_print(&switches);
+}
+
+int
+main(int argc, char** argv)
+{
+    struct topic_partition_limits_t limits = TOPIC_PARTITION_DEFAULT_LIMITS;
+    struct topic_partition_t*       parts;
+    size_t n = argc > 1 ? strtoul(argv[1], NULL, 0) : 20000, i;
+
+    bench_namespace("bench/replicate_%03lu", TOPICS, RING_LEN, ELEM_SZ);
+    parts = mmap(NULL, 2 * sizeof(struct topic_partition_t),
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ASSERT(parts != MAP_FAILED);
+    limits.max_topics = TOPICS;
+    topic_partition_init_limits(&parts[0], &limits);
+    topic_partition_init_limits(&parts[1], &limits);
+    thinros_node(&pub_node, &parts[0], "pub");
+    thinros_node(&sub_node, &parts[1], "sub");
+    for (i = 0; i < TOPICS; i++)
+    {
+        thinros_advertise_uuid(&publishers[i], &pub_node, i + 1);
+        thinros_subscribe_uuid(&subscribers[i], &sub_node, i + 1, on_message,
+            i == 0 ? PRIO_CRITICAL : PRIO_NORMAL, 0);
+    }
+    thinros_master_init(&master, 2, arena, sizeof(arena));
+    thinros_master_add(&master, &parts[0]);
+    thinros_master_add(&master, &parts[1]);
+    thinros_master_build(&master);
+
+    printf("%lu topics of %lu x %lu bytes, %lu switches\n", TOPICS, RING_LEN,
+        ELEM_SZ, n);
+    run("idle", 0, 0, n);
+    run("4 busy topics, 1 msg", 4, 1, n);
+    run("all topics, 1 msg", TOPICS, 1, n);
+    run("all topics, burst of 16", TOPICS, 16, n / 10);
+    thinros_master_budget(&master, 64 * _1k, 0);
+    run("burst of 16, 64 KB budget", TOPICS, 16, n / 10);
+    thinros_master_budget(&master, 0, 20000);
+    run("burst of 16, 20 us budget", TOPICS, 16, n / 10);
+
+    munmap(parts, 2 * sizeof(struct topic_partition_t));
+    return 0;
+}
@@ -0,0 +1,161 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "lib/thinros_core.h"
+#include "lib/thinros_linux.h"
+#include "test/thinros_bench_common.h"
+
+/*
+ * exporting large messages from a ring to a TCP socket and to a file, the
+ * way a bridge forwards camera frames or point clouds: write(2) from the
+ * mapped slot against thinros_splice() of the same slot. the partition is a
+ * shared memory object (THINROS_BIND_SHM), which splices like the driver.
+ * a child process drains the socket. built with its own namespace.
+ *
+ * usage: thinros_bench_splice [messages] [file]
+ */
+
+#define RING_LEN (8lu)
+#define ELEM_SZ  (128lu * _1k)
+#define UUID     (1lu) /* the one topic of bench_namespace() */
+
+struct topic_namespace_t topic_namespace;
+struct topic_layout_t    topic_layout; /* no static rings */
+
+static struct node_handle_t bench_node;
+static struct publisher_t   publisher;
+static struct subscriber_t  subscriber;
+static uint8_t              message[ELEM_SZ];
+
+static void
+on_message(void* msg)
+{
+    (void)msg;
+}
+
+/* a loopback connection whose other end a child reads and discards */
+static int
+tcp_sink(pid_t* child)
+{
+    struct sockaddr_in addr = { .sin_family = AF_INET };
+    socklen_t          len  = sizeof(addr);
+    static char        buffer[ELEM_SZ];
+    int                lfd, fd;
+
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    lfd = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT(lfd >= 0);
+    ASSERT(bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    ASSERT(listen(lfd, 1) == 0);
+    ASSERT(getsockname(lfd, (struct sockaddr*)&addr, &len) == 0);
+
+    *child = fork();
+    if (*child == 0)
+    {
+        fd = accept(lfd, NULL, NULL);
+        while (read(fd, buffer, sizeof(buffer)) > 0)
+            ;
+        _exit(0);
+    }
+    close(lfd);
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    return fd;
+}
+
+/* publish `n` messages and send each one from its slot, ns per message */
+static double
+run(struct thinros_ipc* ipc, int fd, bool splice, bool rewind, size_t n)
+{
+    struct topic_data_t* d;
+    uint64_t t0, total = 0;
+    size_t   i;
+    ssize_t  sent;
+
+    for (i = 0; i < n; i++)
+    {
+        message[0] = (uint8_t)i;
+        thinros_publish(&publisher, message, sizeof(message));
+        d = topic_reader_read_next(&subscriber.local_reader);
+        ASSERT(d != NULL);
+        if (rewind && i % RING_LEN == 0)
+        {
+            /* a file the size of the ring, not of the run */
+            lseek(fd, 0, SEEK_SET);
+        }
+
+        t0   = thinros_now();
+        sent = splice ? thinros_splice(ipc, d->data, ELEM_SZ, fd)
+                      : write(fd, d->data, ELEM_SZ);
+        total += thinros_now() - t0;
+        ASSERT(sent == (ssize_t)ELEM_SZ);
+        topic_reader_complete(&subscriber.local_reader);
+    }
+    return (double)total / n;
+}
+
+static void
+report(const char* sink, double copy, double spliced)
+{
+    printf("%-5s write %8.1f ns/msg (%5.2f GB/s), "
+           "splice %8.1f ns/msg (%5.2f GB/s)\n",
+        sink, copy, ELEM_SZ / copy, spliced, ELEM_SZ / spliced);
+}
+
+int
+main(int argc, char** argv)
+{
+    struct thinros_bind_config_t cfg = {
+        .flags    = THINROS_BIND_SHM | THINROS_BIND_PREFAULT,
+        .shm_name = "/thinros_bench_splice",
+    };
+    size_t              n    = argc > 1 ? strtoul(argv[1], NULL, 0) : 20000;
+    const char*         path = argc > 2 ? argv[2] : "/tmp/thinros_bench_splice";
+    struct thinros_ipc* ipc;
+    double              copy, spliced;
+    pid_t               child;
+    int                 fd;
+
+    signal(SIGPIPE, SIG_IGN);
+    bench_namespace("bench/frame_%lu", 1, RING_LEN, ELEM_SZ);
+    thinros_bind_remove(&cfg);
+    ipc = thinros_bind_config(&cfg);
+    ASSERT(ipc != NULL);
+    topic_partition_init(ipc->par);
+    thinros_node(&bench_node, ipc->par, "bench");
+    thinros_advertise_uuid(&publisher, &bench_node, UUID);
+    thinros_subscribe_uuid(
+        &subscriber, &bench_node, UUID, on_message, PRIO_NORMAL, 0);
+    printf("%lu messages of %lu KB\n", n, ELEM_SZ / _1k);
+
+    fd = tcp_sink(&child);
+    run(ipc, fd, false, false, RING_LEN); /* connection warm up */
+    copy    = run(ipc, fd, false, false, n);
+    spliced = run(ipc, fd, true, false, n);
+    report("tcp", copy, spliced);
+    close(fd);
+    waitpid(child, NULL, 0);
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    ASSERT(fd >= 0);
+    copy    = run(ipc, fd, false, true, n);
+    spliced = run(ipc, fd, true, true, n);
+    report("file", copy, spliced);
+    close(fd);
+    unlink(path);
+
+    thinros_unbind(ipc);
+    thinros_bind_remove(&cfg);
+    return 0;
+}
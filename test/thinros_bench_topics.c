@@ -0,0 +1,148 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib/thinros_core.h"
+#include "test/thinros_bench_common.h"
+
+/*
+ * cost of advertise / subscribe / lookup with 8, 128 and 1024 topics, hashed
+ * index against the linear scans it replaced. built with MAX_TOPICS=1024 and
+ * its own synthetic namespace, the partition is sized for 1024 topics.
+ */
+
+#define LOOKUPS (1000000lu)
+
+struct topic_namespace_t topic_namespace;
+struct topic_layout_t    topic_layout; /* no static rings */
+
+static struct topic_partition_t bench_part;
+static struct node_handle_t     bench_node;
+static struct publisher_t       publishers[MAX_TOPICS];
+static struct subscriber_t      subscribers[MAX_TOPICS];
+static size_t                   queries[LOOKUPS];
+
+static void
+on_message(void* data)
+{
+    (void)data;
+}
+
+static struct topic_namespace_item_t*
+linear_query_by_name(const char* name)
+{
+    size_t i;
+    for (i = 0; i < topic_namespace.n; i++)
+    {
+        if (strncmp(name, topic_namespace.topic[i].name, TOPIC_NAME_SIZE) == 0)
+        {
+            return &topic_namespace.topic[i];
+        }
+    }
+    return NULL;
+}
+
+static struct topic_registry_item_t*
+linear_registry_query(struct topic_registry_t* reg, size_t uuid)
+{
+    size_t i;
+    for (i = 0; i < reg->n; i++)
+    {
+        if (reg->topic[i].uuid == uuid)
+        {
+            return &reg->topic[i];
+        }
+    }
+    return NULL;
+}
+
+static void
+run(size_t n)
+{
+    struct topic_partition_limits_t limits = {
+        .max_topics     = MAX_TOPICS,
+        .max_ring_elems = DEFAULT_RING_ELEMS,
+    };
+    uint64_t t0, t1;
+    size_t   i, found;
+
+    bench_namespace("robot/sensor/topic_%04lu", n, 8, 8);
+    topic_partition_init_limits(&bench_part, &limits);
+    thinros_node(&bench_node, &bench_part, "bench");
+    for (i = 0; i < LOOKUPS; i++)
+    {
+        queries[i] = (size_t)rand() % n;
+    }
+
+    printf("%5lu topics:", n);
+
+    t0 = thinros_now();
+    for (i = 0; i < n; i++)
+    {
+        thinros_advertise(
+            &publishers[i], &bench_node, topic_namespace.topic[i].name);
+    }
+    t1 = thinros_now();
+    printf(" advertise %7.1f", (double)(t1 - t0) / n);
+
+    t0 = thinros_now();
+    for (i = 0; i < n; i++)
+    {
+        thinros_subscribe(&subscribers[i], &bench_node,
+            topic_namespace.topic[i].name, on_message);
+    }
+    t1 = thinros_now();
+    printf(" subscribe %7.1f", (double)(t1 - t0) / n);
+
+    found = 0;
+    t0    = thinros_now();
+    for (i = 0; i < LOOKUPS; i++)
+    {
+        found += topic_namespace_query_by_name(
+                     topic_namespace.topic[queries[i]].name)
+              != NULL;
+    }
+    t1 = thinros_now();
+    ASSERT(found == LOOKUPS);
+    printf(" name %6.1f", (double)(t1 - t0) / LOOKUPS);
+
+    t0 = thinros_now();
+    for (i = 0; i < LOOKUPS; i++)
+    {
+        found += linear_query_by_name(topic_namespace.topic[queries[i]].name)
+              != NULL;
+    }
+    t1 = thinros_now();
+    printf(" (linear %7.1f)", (double)(t1 - t0) / LOOKUPS);
+
+    t0 = thinros_now();
+    for (i = 0; i < LOOKUPS; i++)
+    {
+        found += topic_registry_query(topic_partition_registry(&bench_part), queries[i] + 1)
+              != NULL;
+    }
+    t1 = thinros_now();
+    printf(" uuid %6.1f", (double)(t1 - t0) / LOOKUPS);
+
+    t0 = thinros_now();
+    for (i = 0; i < LOOKUPS; i++)
+    {
+        found += linear_registry_query(topic_partition_registry(&bench_part), queries[i] + 1)
+              != NULL;
+    }
+    t1 = thinros_now();
+    printf(" (linear %7.1f) ns/op\n", (double)(t1 - t0) / LOOKUPS);
+    ASSERT(found == 4 * LOOKUPS);
+}
+
+int
+main(int argc, char** argv)
+{
+    srand(42);
+    run(8);
+    run(128);
+    run(1024);
+    return 0;
+}
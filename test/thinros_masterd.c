@@ -0,0 +1,218 @@
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "lib/thinros_core.h"
+#include "lib/thinros_linux.h"
+
+/*
+ * the secure-world master on Linux: attaches the partitions of several
+ * shared memory objects (THINROS_BIND_SHM, nodes select theirs with
+ * THINROS_BIND=shm THINROS_SHM=<name>) or of the driver (`driver<i>` for
+ * its partition i, see THINROS_PARTITION), and replicates between them
+ * like thinros_master_switch_to() does on every world switch.
+ * a round switches to every partition once; rounds run every `-p` ns, or
+ * back to back with `-p 0`, on the main thread pinned with `-c`. every `-b`
+ * ms thinros_master_update() wires the publishers and subscribers that came
+ * or went since, without disturbing the replication of the other topics.
+ * `-B` and `-T` bound the copies of a switch (thinros_master_budget).
+ * `-s` names the broadcast partition (thinros_master_broadcast) of the nodes
+ * binding it with `readonly` and subscribing through thinros_node_broadcast.
+ *
+ * usage: thinros_masterd [-p period ns] [-c cpu] [-f fifo priority]
+ *            [-b update ms] [-a arena KB] [-B budget bytes] [-T budget ns]
+ *            [-s broadcast name|driver<i>] [-d seconds] <name|driver<i>>...
+ */
+
+struct masterd_config_t
+{
+    uint64_t                     period; /* ns between rounds, 0: continuous */
+    struct thinros_exec_config_t exec;   /* of the thread running the rounds */
+    uint64_t                     update; /* ns between checks for new topics */
+    size_t                       arena;  /* bytes of master tables */
+    size_t                       budget_bytes; /* per switch, 0: none */
+    uint64_t                     budget_ns;    /* per switch, 0: none */
+    const char*                  broadcast; /* of the broadcast rings or NULL */
+    uint64_t                     duration;
+};
+
+static volatile sig_atomic_t stop;
+
+static void
+on_signal(int sig)
+{
+    (void)sig;
+    stop = 1;
+}
+
+static struct thinros_ipc*
+masterd_attach(const char* name)
+{
+    struct thinros_bind_config_t cfg = {
+        .flags    = THINROS_BIND_SHM | THINROS_BIND_PREFAULT,
+        .shm_name = name,
+    };
+    struct thinros_ipc* ipc;
+
+    if (strncmp(name, "driver", 6) == 0)
+    {
+        /* `driver<i>`: /dev/thinros<i> */
+        cfg.flags     = THINROS_BIND_PREFAULT;
+        cfg.shm_name  = NULL;
+        cfg.partition = (unsigned int)atoi(name + 6);
+    }
+    ipc = thinros_bind_config(&cfg);
+    if (ipc != NULL && ipc->par->status == PARTITION_UNINITIALIZED)
+    {
+        /* no node laid it out yet, as the secure world does at boot */
+        topic_partition_init(ipc->par);
+    }
+    return ipc;
+}
+
+static void
+usage(const char* prog)
+{
+    fprintf(stderr,
+        "usage: %s [-p period ns] [-c cpu] [-f fifo priority] "
+        "[-b update ms] [-a arena KB] [-B budget bytes] [-T budget ns] "
+        "[-s broadcast name|driver<i>] [-d seconds] <name|driver<i>>...\n",
+        prog);
+    exit(EXIT_FAILURE);
+}
+
+int
+main(int argc, char** argv)
+{
+    struct masterd_config_t cfg = {
+        .period       = 1000000llu,
+        .exec         = { .lock_memory = true },
+        .update       = 1000000000llu,
+        .arena        = 1024 * _1k,
+        .budget_bytes = 0,
+        .budget_ns    = 0,
+        .broadcast    = NULL,
+        .duration     = 0,
+    };
+    struct thinros_master_t    master;
+    struct thinros_histogram_t rounds;
+    struct thinros_ipc**       ipcs;
+    struct thinros_ipc*        broadcast = NULL;
+    uint64_t*                  arena;
+    uint64_t start, now, next, next_update, next_report, t0;
+    size_t   n, i, total = 0;
+    int      opt;
+
+    while ((opt = getopt(argc, argv, "p:c:f:b:a:B:T:s:d:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'p': cfg.period = strtoull(optarg, NULL, 0); break;
+        case 'c': cfg.exec.cpu_mask = 1llu << atoi(optarg); break;
+        case 'f': cfg.exec.sched_priority = atoi(optarg); break;
+        case 'b': cfg.update = strtoull(optarg, NULL, 0) * 1000000llu; break;
+        case 'a': cfg.arena = strtoull(optarg, NULL, 0) * _1k; break;
+        case 'B': cfg.budget_bytes = strtoull(optarg, NULL, 0); break;
+        case 'T': cfg.budget_ns = strtoull(optarg, NULL, 0); break;
+        case 's': cfg.broadcast = optarg; break;
+        case 'd': cfg.duration = strtoull(optarg, NULL, 0) * 1000000000llu; break;
+        default: usage(argv[0]);
+        }
+    }
+    n = (size_t)(argc - optind);
+    if (n == 0)
+    {
+        usage(argv[0]);
+    }
+
+    ipcs  = calloc(n, sizeof(struct thinros_ipc*));
+    arena = malloc(cfg.arena);
+    thinros_master_init(&master, n, arena, cfg.arena);
+    for (i = 0; i < n; i++)
+    {
+        ipcs[i] = masterd_attach(argv[optind + i]);
+        if (ipcs[i] == NULL)
+        {
+            return EXIT_FAILURE;
+        }
+        thinros_master_add(&master, ipcs[i]->par);
+    }
+    if (cfg.broadcast != NULL)
+    {
+        broadcast = masterd_attach(cfg.broadcast);
+        if (broadcast == NULL)
+        {
+            return EXIT_FAILURE;
+        }
+        thinros_master_broadcast(&master, broadcast->par);
+    }
+    thinros_master_budget(&master, cfg.budget_bytes, cfg.budget_ns);
+    thinros_master_build(&master);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    thinros_exec_apply_config(&cfg.exec, NULL);
+    thinros_histogram_reset(&rounds);
+    printf("replicating %lu partitions, period %lu ns%s\n", n,
+        (size_t)cfg.period, cfg.period == 0 ? " (continuous)" : "");
+
+    start = next = time_ns();
+    next_update = start + cfg.update;
+    next_report = start + 1000000000llu;
+    while (!stop)
+    {
+        t0 = thinros_now();
+        for (i = 0; i < n; i++)
+        {
+            thinros_master_switch_to(&master, i);
+        }
+        thinros_histogram_record(&rounds, thinros_now() - t0);
+
+        now = time_ns();
+        if (now >= next_update)
+        {
+            /* same thread as the rounds, the tables are not shared */
+            thinros_master_update(&master);
+            next_update = now + cfg.update;
+        }
+        if (now >= next_report)
+        {
+            total += rounds.count;
+            printf("%lu rounds, round (ns) ", (size_t)rounds.count);
+            thinros_histogram_print(&rounds);
+            thinros_histogram_reset(&rounds);
+            next_report += 1000000000llu;
+        }
+        if (cfg.duration != 0 && now - start >= cfg.duration)
+        {
+            break;
+        }
+        if (cfg.period != 0)
+        {
+            next += cfg.period;
+            sleep_until_ns(next);
+        }
+    }
+
+    total += rounds.count;
+    printf("%lu rounds in %.1f s\n", total,
+        (double)(time_ns() - start) / 1e9);
+    thinros_master_print(&master);
+    for (i = 0; i < n; i++)
+    {
+        thinros_unbind(ipcs[i]);
+    }
+    if (broadcast != NULL)
+    {
+        thinros_unbind(broadcast);
+    }
+    free(arena);
+    free(ipcs);
+    return EXIT_SUCCESS;
+}
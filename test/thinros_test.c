@@ -1,5 +1,11 @@
 #include "../lib/thinros_core.h"
+#include "../lib/thinros_linux.h"
+#include <signal.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 /*-- unit test section --*/
 #define UNIT_TEST
@@ -13,6 +19,8 @@ struct test_data_t
 
 static TOPIC_RING_DEFINE(test_ring, 128, struct test_data_t);
 static TOPIC_RING_DEFINE(test_ring2, 128, struct test_data_t);
+static TOPIC_READER_STATE_DEFINE(test_read_ring, 128);
+static TOPIC_READER_STATE_DEFINE(test_copy_read_ring, 128);
 static struct topic_reader_t test_reader;
 static struct topic_writer_t test_writer;
 static struct test_data_t test_rx;
@@ -67,7 +75,7 @@ static void test_topic_reader_writer(void)
 
 	struct topic_reader_t *rd = &test_reader;
 	bool succ;
-	topic_reader_init(rd, ring);
+	topic_reader_init(rd, ring, test_read_ring);
 	topic_reader_print(rd);
 	succ = topic_reader_read(rd, test_rx.arr, 32);
 	info("succ %d: ", succ);
@@ -115,6 +123,517 @@ static void test_topic_namespace(void)
 		info("not found\n");
 }
 
+static void test_namespace_shared(void)
+{
+	const char *path = "/tmp/thinros_test.topics";
+	struct topic_namespace_item_t *ns;
+	FILE *f = fopen(path, "w");
+	int n;
+
+	/* a bad entry leaves the partition alone, the load can be retried */
+	ASSERT(f != NULL);
+	fprintf(f, "drv_steer 1 32 0\n");
+	fclose(f);
+	struct topic_partition_limits_t limits = TOPIC_PARTITION_DEFAULT_LIMITS;
+	memset(&other_part, 0, sizeof(other_part));
+	n = thinros_load_namespace(&other_part, &limits, path);
+	info("element size 0: %s, partition %s\n", n < 0 ? "rejected" : "loaded",
+		 other_part.status == PARTITION_UNINITIALIZED ? "untouched" : "set up");
+
+	f = fopen(path, "w");
+	ASSERT(f != NULL);
+	fprintf(f, "# name      uuid length elem_sz\n"
+			   "drv_steer      1   32     4\n"
+			   "\n"
+			   "arm/joints    10    8   256  # not in the compiled namespace\n");
+	fclose(f);
+	info("loaded %d topics\n", thinros_load_namespace(&other_part, &limits, path));
+	remove(path);
+
+	ns = topic_namespace_table_query_by_name(topic_partition_namespace(&other_part),
+											 "arm/joints");
+	if (ns != NULL)
+		info("shared ns %s %lu len %lu elem_sz %lu\n", ns->name, ns->uuid,
+			 ns->length, ns->elem_sz);
+	ns = topic_namespace_table_query_by_name(topic_partition_namespace(&other_part),
+											 "fwd_scan");
+	info("fwd_scan %s in the shared namespace\n", ns != NULL ? "found" : "not found");
+	topic_partition_get(&other_part, 10);
+	topic_partition_print(&other_part);
+}
+
+static void test_partition_layout(void)
+{
+	struct topic_layout_item_t *item;
+	size_t brk;
+
+	topic_partition_init(&this_part);
+	brk = this_part.allocator.brk;
+	info("static layout of %lu topics, %lu bytes:\n", topic_layout.n,
+		 topic_layout.size);
+	for (item = topic_layout.topic; item < topic_layout.topic + topic_layout.n;
+		 item++)
+	{
+		struct topic_registry_item_t *topic =
+			topic_partition_get(&this_part, item->uuid);
+		info("  uuid %lu local 0x%lx (registry 0x%lx external 0x%lx)\n",
+			 item->uuid, item->local_ring, topic->local_ring,
+			 topic->external_ring);
+	}
+	info("no allocation on first use: %s\n",
+		 brk == this_part.allocator.brk ? "yes" : "no");
+	if (topic_layout.n > 0)
+	{
+		struct topic_registry_item_t *topic =
+			topic_partition_get(&this_part, topic_layout.topic[0].uuid);
+		topic_partition_external_ring(&this_part, topic);
+		info("external ring on the first subscription: %s\n",
+			 topic->external_ring != INVALID_RELATIVE_ADDR
+				 && topic->external_ring >= topic_layout.size
+			 ? "allocated" : "no");
+	}
+}
+
+static void test_topic_remove(void)
+{
+	struct topic_partition_limits_t limits = TOPIC_PARTITION_DEFAULT_LIMITS;
+	struct topic_partition_usage_t usage;
+	struct topic_registry_item_t *topic;
+	static struct publisher_t pub;
+	static struct subscriber_t sub;
+	size_t available;
+
+	topic_partition_init_limits(&this_part, &limits);
+	thinros_node(&test_node_a, &this_part, "node a");
+	thinros_advertise_uuid(&pub, &test_node_a, 1);
+	topic = topic_partition_get(&this_part, 1);
+	topic_partition_usage(&this_part, &usage);
+	info("publish only: local 0x%lx external 0x%lx, in use %lu\n",
+		 topic->local_ring, topic->external_ring, usage.in_use);
+	thinros_subscribe_uuid(&sub, &test_node_a, 1, test_dummy_callback,
+						   PRIO_NORMAL, NO_DEADLINE);
+	topic_partition_usage(&this_part, &usage);
+	info("subscribed: external 0x%lx, in use %lu\n", topic->external_ring,
+		 usage.in_use);
+
+	topic_partition_remove(&this_part, 1);
+	topic_partition_usage(&this_part, &usage);
+	info("removed: local 0x%lx, released %lu\n", topic->local_ring,
+		 usage.released);
+	/* no master, nothing else can be wired to the rings */
+	topic_partition_reclaim(&this_part,
+		topic_partition_registry(&this_part)->generation);
+	topic_partition_usage(&this_part, &usage);
+	available = usage.available;
+	info("reclaimed: released %lu\n", usage.released);
+	topic_partition_local_ring(&this_part, topic_partition_get(&this_part, 1));
+	topic_partition_usage(&this_part, &usage);
+	info("again: released %lu, freed blocks reused: %s\n", usage.released,
+		 usage.available == available ? "yes" : "no");
+
+	/* a restarted process keeps the blocks of the registered topics */
+	topic_nonsecure_partition_init(&this_part);
+	topic_partition_print(&this_part);
+}
+
+static void test_registry_concurrent(void)
+{
+	struct topic_partition_limits_t limits = TOPIC_PARTITION_DEFAULT_LIMITS;
+	struct topic_partition_t *par;
+	struct topic_registry_t *reg;
+	size_t i, j, dup = 0;
+	int k;
+
+	/* processes starting at once register the same topics */
+	par = mmap(NULL, sizeof(*par), PROT_READ | PROT_WRITE,
+			   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	ASSERT(par != MAP_FAILED);
+	topic_partition_init_limits(par, &limits);
+	for (k = 0; k < 8; k++)
+	{
+		if (fork() == 0)
+		{
+			for (i = 0; i < topic_namespace.n; i++)
+				topic_partition_get(par, topic_namespace.topic[
+					(i + k) % topic_namespace.n].uuid);
+			_exit(0);
+		}
+	}
+	while (wait(NULL) > 0)
+		;
+	reg = topic_partition_registry(par);
+	for (i = 0; i < reg->n; i++)
+		for (j = i + 1; j < reg->n; j++)
+			dup += reg->topic[i].uuid == reg->topic[j].uuid;
+	info("8 processes registered %lu of %lu topics, duplicates %lu\n",
+		 (size_t)reg->n, topic_namespace.n, dup);
+
+	/* registrations failing on a full registry do not use up the index */
+	limits.max_topics = 2;
+	topic_partition_init_limits(par, &limits);
+	reg = topic_partition_registry(par);
+	for (i = 0; i < topic_namespace.n; i++)
+		topic_partition_get(par, topic_namespace.topic[i].uuid);
+	for (i = 0, j = 0; i < reg->index_slots; i++)
+		j += topic_registry_index(reg)[i].key != 0;
+	info("registry of %lu: %lu of %lu index slots taken, lookup of the "
+		 "last topic: %s\n", reg->max_topics, j, (size_t)reg->index_slots,
+		 topic_partition_get(par, topic_namespace.topic[
+			topic_namespace.n - 1].uuid) == NULL ? "not found" : "found");
+	munmap(par, sizeof(*par));
+}
+
+static size_t test_reattach_received;
+
+static void test_reattach_callback(void *data)
+{
+	(void)data;
+	test_reattach_received++;
+}
+
+static void test_node_reattach(void)
+{
+	struct topic_partition_limits_t limits = TOPIC_PARTITION_DEFAULT_LIMITS;
+	struct topic_partition_usage_t usage;
+	static struct publisher_t pub;
+	static struct subscriber_t sub;
+	float value = 1.0f;
+	size_t i, in_use;
+
+	topic_partition_init_limits(&this_part, &limits);
+	info("partition version %016lx, compatible: %s\n",
+		 (unsigned long)this_part.version,
+		 topic_partition_compatible(&this_part) ? "yes" : "no");
+	/* a process calibrated on its own adopts the partition's clock */
+	if (thinros_clock.source == CLOCK_SOURCE_COUNTER)
+	{
+		thinros_clock.mult++;
+		topic_nonsecure_partition_init(&this_part);
+		info("clock of the partition adopted: %s\n",
+			 thinros_clock.mult == this_part.clock.mult ? "yes" : "no");
+	}
+	thinros_node(&test_node_a, &this_part, "talker");
+	thinros_advertise_uuid(&pub, &test_node_a, 1);
+	thinros_node(&test_node_b, &this_part, "listener");
+	thinros_subscribe_uuid(&sub, &test_node_b, 1, test_reattach_callback,
+						   PRIO_NORMAL, NO_DEADLINE);
+	for (i = 0; i < 3; i++)
+		thinros_publish(&pub, &value, sizeof(value));
+	thinros_spin(&test_node_b, SPIN_ONCE, NULL, 0);
+	info("before the restart: %lu received\n", test_reattach_received);
+
+	/* the listener restarts while two messages are published */
+	for (i = 0; i < 2; i++)
+		thinros_publish(&pub, &value, sizeof(value));
+	topic_partition_usage(&this_part, &usage);
+	in_use = usage.in_use;
+	test_reattach_received = 0;
+	thinros_node(&test_node_b, &this_part, "listener");
+	thinros_subscribe_uuid(&sub, &test_node_b, 1, test_reattach_callback,
+						   PRIO_NORMAL, NO_DEADLINE);
+	thinros_spin(&test_node_b, SPIN_ONCE, NULL, 0);
+	topic_partition_usage(&this_part, &usage);
+	info("resumed at head: %lu received, reader state reused: %s\n",
+		 test_reattach_received, usage.in_use == in_use ? "yes" : "no");
+
+	for (i = 0; i < 2; i++)
+		thinros_publish(&pub, &value, sizeof(value));
+	test_reattach_received = 0;
+	thinros_node(&test_node_b, &this_part, "listener");
+	thinros_node_resume(&test_node_b, RESUME_AT_SAVED);
+	thinros_subscribe_uuid(&sub, &test_node_b, 1, test_reattach_callback,
+						   PRIO_NORMAL, NO_DEADLINE);
+	thinros_spin(&test_node_b, SPIN_ONCE, NULL, 0);
+	info("resumed at the saved position: %lu received\n",
+		 test_reattach_received);
+}
+
+static size_t test_shm_received;
+
+static void test_shm_callback(void *data)
+{
+	(void)data;
+	test_shm_received++;
+}
+
+static void test_bind_shm(void)
+{
+	struct thinros_bind_config_t cfg = { .flags = THINROS_BIND_SHM };
+	struct thinros_ipc *ipc, *ro;
+	static struct node_handle_t node;
+	static struct publisher_t pub;
+	static struct subscriber_t sub;
+	char name[32];
+	float value = 1.0f;
+	int ready[2], done[2], status = 0, writable;
+	size_t i;
+
+	/* a publisher and a subscriber process on a partition without driver */
+	snprintf(name, sizeof(name), "/thinros_test_%d", (int)getpid());
+	cfg.shm_name = name;
+	ASSERT(pipe(ready) == 0 && pipe(done) == 0);
+	ipc = thinros_bind_config(&cfg);
+	ASSERT(ipc != NULL && ipc->par->status == PARTITION_UNINITIALIZED);
+	topic_partition_init(ipc->par);
+
+	if (fork() == 0)
+	{
+		ipc = thinros_bind_config(&cfg);
+		ASSERT(ipc != NULL);
+		topic_nonsecure_partition_init(ipc->par);
+		thinros_node(&node, ipc->par, "listener");
+		thinros_subscribe_uuid(&sub, &node, 1, test_shm_callback,
+							   PRIO_NORMAL, NO_DEADLINE);
+		ASSERT(write(ready[1], "", 1) == 1);
+		ASSERT(read(done[0], &value, 1) == 1);
+		thinros_spin(&node, SPIN_ONCE, NULL, 0);
+		thinros_unbind(ipc);
+		_exit((int)test_shm_received);
+	}
+	topic_nonsecure_partition_init(ipc->par);
+	thinros_node(&node, ipc->par, "talker");
+	thinros_advertise_uuid(&pub, &node, 1);
+	ASSERT(read(ready[0], &value, 1) == 1);
+	for (i = 0; i < 3; i++)
+		thinros_publish(&pub, &value, sizeof(value));
+	ASSERT(write(done[1], "", 1) == 1);
+	wait(&status);
+	info("shared memory partition %s: 3 published, %d received\n", name,
+		 WEXITSTATUS(status));
+
+	/* a read-only process cannot make its mapping writable again */
+	cfg.flags |= THINROS_BIND_READONLY;
+	ro = thinros_bind_config(&cfg);
+	ASSERT(ro != NULL);
+	writable = mprotect(ro->par, ro->size, PROT_READ | PROT_WRITE) == 0;
+	info("read-only binding: version %s, writable: %s\n",
+		 ro->par->version == ipc->par->version ? "same" : "differs",
+		 writable ? "yes" : "no");
+	thinros_unbind(ro);
+	thinros_unbind(ipc);
+	thinros_bind_remove(&cfg);
+}
+
+static void test_bind_sparse(void)
+{
+	struct thinros_bind_config_t cfg = {
+		.flags = THINROS_BIND_SHM | THINROS_BIND_SPARSE,
+	};
+	struct thinros_ipc *ipc;
+	static struct node_handle_t node;
+	static struct subscriber_t sub;
+	struct topic_registry_item_t *topic;
+	char name[32];
+	int status = 0;
+
+	/* the node's partition only, its subscribed rings read-only */
+	snprintf(name, sizeof(name), "/thinros_sparse_%d", (int)getpid());
+	cfg.shm_name = name;
+	ipc = thinros_bind_config(&cfg);
+	ASSERT(ipc != NULL);
+	topic_partition_init(ipc->par);
+	thinros_node(&node, ipc->par, "listener");
+	/* the largest ring of the namespace, protected pages need a whole one */
+	thinros_subscribe_uuid(&sub, &node, 3, test_shm_callback, PRIO_NORMAL,
+						   NO_DEADLINE);
+	ASSERT(thinros_protect_topic(ipc, 3) == 0);
+	thinros_spin(&node, SPIN_ONCE, NULL, 0);
+
+	topic = topic_registry_query(topic_partition_registry(ipc->par), 3);
+	if (fork() == 0)
+	{
+		/* a stray write in the middle of the external ring */
+		ipc->par->topic_buffer[topic->external_ring
+			+ topic->length * topic->elem_sz / 2] = 0xff;
+		_exit(0);
+	}
+	wait(&status);
+	info("sparse binding maps %lu of %lu KB, write to a protected ring: %s\n",
+		 ipc->size / _1k, NONSECURE_PARTITION_SIZE / _1k,
+		 WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV ? "SIGSEGV"
+															 : "allowed");
+	thinros_unbind(ipc);
+	thinros_bind_remove(&cfg);
+}
+
+/*
+ * topics wired after the build: p1 publishes and p2 subscribes, then p2
+ * publishes and p1 subscribes too. the replicator into p2 keeps its reader,
+ * so none of the messages already copied is copied twice.
+ */
+static struct thinros_master_t test_update_master;
+static uint64_t test_update_arena[8 * _1k];
+static struct node_handle_t test_update_nodes[4];
+static struct publisher_t test_update_pubs[2];
+static struct subscriber_t test_update_subs[2];
+
+static void test_master_update(void)
+{
+	struct thinros_master_t *m = &test_update_master;
+	struct topic_partition_t *p1, *p2;
+	struct subscriber_t *sub_p2 = &test_update_subs[1];
+	struct topic_partition_usage_t usage;
+	size_t changes, in_use;
+
+	p1 = mmap(NULL, 2 * sizeof(struct topic_partition_t),
+			  PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	ASSERT(p1 != MAP_FAILED);
+	p2 = p1 + 1;
+	topic_partition_init(p1);
+	topic_partition_init(p2);
+	thinros_master_init(m, 2, test_update_arena, sizeof(test_update_arena));
+	thinros_master_add(m, p1);
+	/* as if laid out by a process with a calibration of its own */
+	p2->clock.base_ns++;
+	thinros_master_add(m, p2);
+	thinros_master_build(m);
+	info("clock of p2 stamped with the master's: %s\n",
+		 memcmp(&p1->clock, &p2->clock, sizeof(p1->clock)) == 0 ? "yes" : "no");
+
+	thinros_node(&test_update_nodes[0], p1, "a");
+	thinros_node(&test_update_nodes[1], p2, "d");
+	thinros_advertise(&test_update_pubs[0], &test_update_nodes[0], "fwd_scan");
+	thinros_subscribe(sub_p2, &test_update_nodes[1], "fwd_scan",
+					  test_dummy_callback);
+	changes = thinros_master_update(m);
+	thinros_publish(&test_update_pubs[0], "msg 1", 16);
+	thinros_publish(&test_update_pubs[0], "msg 2", 16);
+	thinros_publish(&test_update_pubs[0], "msg 3", 16);
+	thinros_master_switch_to(m, 1);
+	info("update: %lu changes, p2 external ring head %lu (expect 3)\n",
+		 changes, sub_p2->external_reader.ring->head);
+
+	thinros_node(&test_update_nodes[2], p2, "c");
+	thinros_node(&test_update_nodes[3], p1, "b");
+	thinros_advertise(&test_update_pubs[1], &test_update_nodes[2], "fwd_scan");
+	thinros_subscribe(&test_update_subs[0], &test_update_nodes[3], "fwd_scan",
+					  test_dummy_callback);
+	changes = thinros_master_update(m);
+	thinros_publish(&test_update_pubs[0], "msg 4", 16);
+	thinros_publish(&test_update_pubs[1], "msg 5", 16);
+	thinros_master_switch_to(m, 0);
+	thinros_master_switch_to(m, 1);
+	info("update: %lu changes, p2 external ring head %lu (expect 4), "
+		 "p1 external ring head %lu (expect 1)\n", changes,
+		 sub_p2->external_reader.ring->head,
+		 test_update_subs[0].external_reader.ring->head);
+	info("update without changes: %lu\n", thinros_master_update(m));
+	/* more changes than the log holds: all items are walked again */
+	atomic_fetch_add(&topic_partition_registry(p2)->generation,
+					 TOPIC_REGISTRY_LOG + 1);
+	info("update past the change log: %lu (expect 0)\n",
+		 thinros_master_update(m));
+
+	/* no room for a message of fwd_scan, a PRIO_NORMAL topic */
+	thinros_master_budget(m, 1, 0);
+	thinros_publish(&test_update_pubs[0], "msg 6", 16);
+	thinros_publish(&test_update_pubs[0], "msg 7", 16);
+	thinros_master_switch_to(m, 1);
+	info("budget: p2 external ring head %lu (expect 4), deferred %lu "
+		 "(expect 2)\n", sub_p2->external_reader.ring->head,
+		 m->partitions[1].stats.deferred);
+	thinros_master_budget(m, 0, 0);
+	thinros_master_switch_to(m, 1);
+	info("no budget: p2 external ring head %lu (expect 6)\n",
+		 sub_p2->external_reader.ring->head);
+
+	/* the rings are only released once the master has unwired them */
+	topic_partition_remove(p1, test_update_pubs[0].topic_uuid);
+	topic_partition_usage(p1, &usage);
+	in_use = usage.in_use;
+	changes = thinros_master_update(m);
+	topic_partition_usage(p1, &usage);
+	info("remove from p1: %lu changes, replicators p1 %lu p2 %lu "
+		 "(expect 0 1), p2 sources %lu (expect 0)\n", changes,
+		 m->partitions[0].n_replicators, m->partitions[1].n_replicators,
+		 m->partitions[1].replicators[0]->n_sources);
+	info("p1 in use %lu before the update, %lu after\n", in_use,
+		 usage.in_use);
+	munmap(p1, 2 * sizeof(struct topic_partition_t));
+}
+
+/*
+ * p1 publishes and the nodes of p1, p2 and p3 subscribe through the
+ * broadcast partition: each message is copied once, into the broadcast ring,
+ * and delivered once to every node, p1's own from its local ring. then p2
+ * publishes too.
+ */
+static struct thinros_master_t test_bc_master;
+static uint64_t test_bc_arena[16 * _1k];
+static struct node_handle_t test_bc_nodes[3];
+static struct publisher_t test_bc_pubs[2];
+static struct subscriber_t test_bc_subs[3];
+static size_t test_bc_received[3];
+static msg_steer_t test_bc_msg;
+
+static void test_bc_callback_0(void *msg) { (void)msg; test_bc_received[0]++; }
+static void test_bc_callback_1(void *msg) { (void)msg; test_bc_received[1]++; }
+static void test_bc_callback_2(void *msg) { (void)msg; test_bc_received[2]++; }
+
+static void test_master_broadcast(void)
+{
+	static const thinros_callback_on_t callbacks[3] = {
+		test_bc_callback_0, test_bc_callback_1, test_bc_callback_2
+	};
+	static const char *names[3] = { "b1", "b2", "b3" };
+	struct thinros_master_t *m = &test_bc_master;
+	struct topic_partition_t *p, *bc;
+	size_t i;
+
+	p = mmap(NULL, 4 * sizeof(struct topic_partition_t),
+			 PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	ASSERT(p != MAP_FAILED);
+	bc = p + 3;
+	thinros_master_init(m, 3, test_bc_arena, sizeof(test_bc_arena));
+	for (i = 0; i < 4; i++)
+	{
+		topic_partition_init(&p[i]);
+	}
+	for (i = 0; i < 3; i++)
+	{
+		thinros_master_add(m, &p[i]);
+	}
+	thinros_master_broadcast(m, bc);
+	thinros_master_build(m);
+
+	for (i = 0; i < 3; i++)
+	{
+		thinros_node(&test_bc_nodes[i], &p[i], names[i]);
+		thinros_node_broadcast(&test_bc_nodes[i], bc);
+		thinros_subscribe(&test_bc_subs[i], &test_bc_nodes[i], "drv_steer",
+						  callbacks[i]);
+	}
+	thinros_advertise(&test_bc_pubs[0], &test_bc_nodes[0], "drv_steer");
+	thinros_master_update(m);
+	thinros_publish(&test_bc_pubs[0], &test_bc_msg, sizeof(test_bc_msg));
+	thinros_publish(&test_bc_pubs[0], &test_bc_msg, sizeof(test_bc_msg));
+	thinros_publish(&test_bc_pubs[0], &test_bc_msg, sizeof(test_bc_msg));
+	thinros_master_switch_to(m, 1);
+	for (i = 0; i < 3; i++)
+	{
+		thinros_spin(&test_bc_nodes[i], SPIN_ONCE, NULL, 0);
+	}
+	info("broadcast: received %lu %lu %lu (expect 3 3 3), copied %lu "
+		 "(expect 3)\n", test_bc_received[0], test_bc_received[1],
+		 test_bc_received[2], (size_t)m->broadcast.stats.copied);
+
+	thinros_advertise(&test_bc_pubs[1], &test_bc_nodes[1], "drv_steer");
+	thinros_master_update(m);
+	thinros_publish(&test_bc_pubs[1], &test_bc_msg, sizeof(test_bc_msg));
+	thinros_publish(&test_bc_pubs[1], &test_bc_msg, sizeof(test_bc_msg));
+	thinros_master_switch_to(m, 0);
+	for (i = 0; i < 3; i++)
+	{
+		thinros_spin(&test_bc_nodes[i], SPIN_ONCE, NULL, 0);
+	}
+	info("broadcast from p2: received %lu %lu %lu (expect 5 5 5), copied "
+		 "%lu (expect 5), replicators p1 %lu p2 %lu p3 %lu (expect 0 0 0)\n",
+		 test_bc_received[0], test_bc_received[1], test_bc_received[2],
+		 (size_t)m->broadcast.stats.copied, m->partitions[0].n_replicators,
+		 m->partitions[1].n_replicators, m->partitions[2].n_replicators);
+	munmap(p, 4 * sizeof(struct topic_partition_t));
+}
+
 static void test_partition_local(void)
 {
 	topic_partition_init(&this_part);
@@ -125,7 +644,7 @@ static void test_partition_local(void)
 	info("ring @ 0x%p ", r);
 	info("now allocator at %lu (addr 0x%lx)\n", this_part.allocator.brk,
 		 this_part.allocator.memory + this_part.allocator.brk);
-	topic = topic_registry_query(&this_part.registry, 1);
+	topic = topic_registry_query(topic_partition_registry(&this_part), 1);
 	r = get_local_ring(&this_part, topic);
 	info("query ring @ 0x%p\n", r);
 
@@ -136,7 +655,7 @@ static void test_partition_local(void)
 	info("ring @ 0x%p ", r);
 	info("now allocator at %lu (addr 0x%lx)\n", this_part.allocator.brk,
 		 this_part.allocator.memory + this_part.allocator.brk);
-	topic = topic_registry_query(&this_part.registry, 1);
+	topic = topic_registry_query(topic_partition_registry(&this_part), 1);
 	r = get_local_ring(&this_part, topic);
 	info("query ring @ 0x%p\n", r);
 
@@ -148,7 +667,7 @@ static void test_partition_local(void)
 	info("now allocator at %lu (addr 0x%lx)\n", this_part.allocator.brk,
 		 this_part.allocator.memory + this_part.allocator.brk);
 
-    topic = topic_registry_query(&this_part.registry, 2);
+    topic = topic_registry_query(topic_partition_registry(&this_part), 2);
 	r = get_local_ring(&this_part, topic);
 	info("query ring @ 0x%p\n", r);
 
@@ -161,7 +680,7 @@ static void test_partition_local(void)
 	info("now allocator at %lu (addr 0x%lx)\n", this_part.allocator.brk,
 		 this_part.allocator.memory + this_part.allocator.brk);
 
-    topic = topic_registry_query(&this_part.registry, 3);
+    topic = topic_registry_query(topic_partition_registry(&this_part), 3);
 	r = get_local_ring(&this_part, topic);
 	info("query ring @ 0x%p\n", r);
 
@@ -174,7 +693,7 @@ static void test_partition_local(void)
 	info("now allocator at %lu (addr 0x%lx)\n", this_part.allocator.brk,
 		 this_part.allocator.memory + this_part.allocator.brk);
 
-    topic = topic_registry_query(&this_part.registry, 1);
+    topic = topic_registry_query(topic_partition_registry(&this_part), 1);
 	r = get_local_ring(&this_part, topic);
 	info("query ring @ 0x%p\n", r);
 
@@ -213,6 +732,107 @@ static void test_partition_local(void)
 	thinros_spin(&test_node_b, SPIN_ONCE, NULL, 0);
 }
 
+static struct node_handle_t test_node_prio;
+static struct publisher_t test_prio_steer_pub, test_prio_throttle_pub;
+static struct subscriber_t test_prio_steer_sub, test_prio_throttle_sub;
+
+static void test_prio_steer_callback(void *data)
+{
+	info("[critical] steer %f\n", ((msg_steer_t *) data)->value);
+}
+
+static void test_prio_throttle_callback(void *data)
+{
+	info("[low] throttle %f\n", ((msg_throttle_t *) data)->value);
+}
+
+static void test_priority_dispatch(void)
+{
+	struct node_handle_t *n = &test_node_prio;
+	msg_steer_t steer = {.value = 1.0f};
+	msg_throttle_t throttle = {.value = 2.0f};
+
+	topic_partition_init(&other_part);
+	thinros_node(n, &other_part, "prio");
+
+	/* registered first, but serviced last */
+	thinros_subscribe_prio(&test_prio_throttle_sub, n, "drv_throttle",
+						   test_prio_throttle_callback, PRIO_LOW,
+						   NO_DEADLINE);
+	thinros_subscribe_prio(&test_prio_steer_sub, n, "drv_steer",
+						   test_prio_steer_callback, PRIO_CRITICAL,
+						   1000000);
+	thinros_advertise(&test_prio_steer_pub, n, "drv_steer");
+	thinros_advertise(&test_prio_throttle_pub, n, "drv_throttle");
+
+	thinros_publish(&test_prio_throttle_pub, &throttle, sizeof(throttle));
+	thinros_publish(&test_prio_steer_pub, &steer, sizeof(steer));
+	info("spin without budget: steer first, then throttle\n");
+	thinros_spin(n, SPIN_ONCE, NULL, 0);
+
+	thinros_node_budget(n, 1);
+	thinros_publish(&test_prio_throttle_pub, &throttle, sizeof(throttle));
+	thinros_publish(&test_prio_steer_pub, &steer, sizeof(steer));
+	info("spin with 1 ns budget: throttle deferred\n");
+	thinros_spin(n, SPIN_ONCE, NULL, 0);
+	thinros_node_budget(n, 0);
+	info("spin again: deferred throttle delivered\n");
+	thinros_spin(n, SPIN_ONCE, NULL, 0);
+	thinros_node_print_dispatch(n);
+	thinros_node_print_latency(n);
+}
+
+static struct node_handle_t test_node_timer;
+static struct thinros_timer_t test_periodic, test_oneshot, test_far;
+static size_t test_periodic_fired;
+
+static void test_periodic_callback(void *arg)
+{
+	struct node_handle_t *n = arg;
+	test_periodic_fired++;
+	if (test_periodic_fired == 5)
+	{
+		/* stop SPIN_SLEEP */
+		atomic_store(&n->running, false);
+	}
+}
+
+static void test_oneshot_callback(void *arg)
+{
+	info("one-shot timer fired after %lu periods\n", test_periodic_fired);
+}
+
+static void test_timer_wheel(void)
+{
+	struct node_handle_t *n = &test_node_timer;
+	uint64_t start;
+
+	thinros_node(n, &other_part, "timer");
+	thinros_timer_periodic(&test_periodic, n, 10000000llu,
+						   test_periodic_callback, n);
+	thinros_timer_oneshot(&test_oneshot, n, 25000000llu,
+						  test_oneshot_callback, NULL);
+	/* lands on the outer levels of the wheel */
+	thinros_timer_oneshot(&test_far, n, 3600000000000llu,
+						  test_oneshot_callback, NULL);
+
+	start = thinros_now();
+	thinros_spin(n, SPIN_SLEEP, NULL, 0);
+	info("periodic timer fired %lu times in %lu us (overruns %lu)\n",
+		 test_periodic_fired, (thinros_now() - start) / 1000,
+		 test_periodic.overruns);
+	thinros_timer_cancel(&test_periodic);
+	thinros_timer_cancel(&test_far);
+	info("timers left %lu\n", n->timers.n_timers);
+
+	/* without polling, the spin ends with the last timer */
+	thinros_timer_oneshot(&test_oneshot, n, 1000000llu,
+						  test_oneshot_callback, NULL);
+	thinros_spin(n, SPIN_SLEEP, NULL, 0);
+	info("spin after the last timer: returned, timers left %lu\n",
+		 n->timers.n_timers);
+}
+
 static struct topic_reader_t test_copy_reader;
 static struct topic_writer_t test_copy_writer;
 
@@ -236,9 +856,9 @@ static void test_topic_ring_copy(void)
 	struct topic_writer_t *rwr = (struct topic_writer_t *) &test_copy_writer;
 
 	topic_writer_init(wr, r1);
-	topic_reader_init(rd, r2);
+	topic_reader_init(rd, r2, test_read_ring);
 
-	topic_reader_init(rrd, r1);
+	topic_reader_init(rrd, r1, test_copy_read_ring);
 	topic_writer_init(rwr, r2);
 
 	char msg[16];
@@ -291,6 +911,7 @@ static void test_topic_ring_copy(void)
  * ]
  */
 static struct thinros_master_t test_master;
+static uint64_t test_master_arena[4 * _1k];
 static struct node_handle_t test_node_c, test_node_d;
 static struct publisher_t test_node_a_pub, test_node_c_pub;
 static struct subscriber_t test_node_b_sub, test_node_d_sub;
@@ -324,7 +945,7 @@ static void test_thinros_master(void)
 	thinros_subscribe(sub_b, b, "fwd_scan", test_dummy_callback);
 	thinros_subscribe(sub_d, d, "fwd_scan", test_dummy_callback);
 
-	thinros_master_init(m);
+	thinros_master_init(m, 4, test_master_arena, sizeof(test_master_arena));
 	thinros_master_add(m, p1);
 	thinros_master_add(m, p2);
 	thinros_master_build(m);
@@ -335,6 +956,7 @@ static void test_thinros_master(void)
 	thinros_publish(pub_a, "msg 2", 16);
 	thinros_publish(pub_a, "msg 3", 16);
 	thinros_spin(b, SPIN_ONCE, NULL, 0);
+	thinros_node_print_latency(b);
 
 	info("now switch to partition 2\n");
 	thinros_master_switch_to(m, 1);
@@ -346,6 +968,21 @@ static void test_thinros_master(void)
 	info("now switch to partition 1 again\n");
 	thinros_master_switch_to(m, 0);
 	thinros_spin(b, SPIN_ONCE, NULL, 0);
+	thinros_node_print_latency(b);
+}
+
+static void test_histogram(void)
+{
+	static struct thinros_histogram_t h;
+	uint64_t v;
+
+	thinros_histogram_reset(&h);
+	for (v = 1; v <= 100000; v++)
+	{
+		thinros_histogram_record(&h, v);
+	}
+	info("histogram 1..100000: ");
+	thinros_histogram_print(&h);
 }
 
 static void test_all(void)
@@ -353,6 +990,18 @@ static void test_all(void)
 	test_topic_ring();
 	test_topic_reader_writer();
 	test_topic_namespace();
+	test_namespace_shared();
+	test_partition_layout();
+	test_topic_remove();
+	test_registry_concurrent();
+	test_node_reattach();
+	test_bind_shm();
+	test_bind_sparse();
+	test_master_update();
+	test_master_broadcast();
+	test_priority_dispatch();
+	test_timer_wheel();
+	test_histogram();
 	test_partition_local();
 	test_topic_ring_copy();
 	test_thinros_master();